@@ -2,71 +2,947 @@
 // Created by Yimeng Li on 03/06/2018.
 //
 
+#include <new>
+#include <algorithm>
+
 #include "airport.h"
+#include "timer_service.h"
+#include "trace.h"
+#include "logger.h"
+#include "snapshot.h"
+#include "journal.h"
+
+/** Set while this thread grants waiters, so the request paths it calls do not dispatch again. */
+static thread_local bool in_dispatch = false;
+
+/** Sets in_dispatch for its scope; an exception thrown meanwhile cannot leave it set. */
+class DispatchScope {
+private:
+    bool outer;
+
+public:
+    DispatchScope() : outer(in_dispatch) { in_dispatch = true; }
+    ~DispatchScope() { in_dispatch = outer; }
+    DispatchScope(const DispatchScope &) = delete;
+    DispatchScope &operator=(const DispatchScope &) = delete;
+};
+
+/** The runway holder record names the reservation's epoch, class and stand, so an Emergency can
+ * tell what it may take over: epoch << 40 | class << 32 | stand. Takeoffs hold with kTakeoffHolder,
+ * which nothing preempts. */
+static constexpr uint8_t kTakeoffHolder = 0xFF;
+
+static constexpr uint64_t kNoExpiryTick = UINT64_MAX;
+
+static inline uint64_t expiry_tick_of(std::chrono::nanoseconds time) {
+    return static_cast<uint64_t>(time / kExpiryTick);
+}
+
+static inline uint64_t runway_holder(uint32_t epoch, uint8_t holder_class, uint32_t ps_idx) {
+    return (static_cast<uint64_t>(epoch) << 40) | (static_cast<uint64_t>(holder_class) << 32) | ps_idx;
+}
+
+static JournalRecord journal_record(JournalEvent event, std::chrono::nanoseconds time, uint8_t outcome = 0,
+                                    uint8_t priority = 0, uint32_t rw_idx = kInvalidHandle,
+                                    uint32_t ps_idx = kInvalidHandle, uint32_t epoch = 0,
+                                    std::chrono::nanoseconds expiration = std::chrono::nanoseconds(0)) {
+    JournalRecord record = {};
+    record.event = event;
+    record.time = time.count();
+    record.outcome = outcome;
+    record.priority = priority;
+    record.runway = rw_idx;
+    record.parking_stand = ps_idx;
+    record.epoch = epoch;
+    record.expiration = expiration.count();
+    return record;
+}
+
+template<typename Token>
+static JournalRecord journal_record(JournalEvent event, std::chrono::nanoseconds time, uint8_t outcome,
+                                    uint8_t priority, const Token &token) {
+    return journal_record(event, time, outcome, priority, token.runway, token.parking_stand, token.epoch,
+                          token.expiration);
+}
+
+/*
+ * A batch request goes in as its size, then one record per aircraft.
+ * @param tokens: the batch's tokens, or none if it threw
+ */
+template<typename Token>
+static void journal_batch(Journal &journal, JournalEvent event, JournalEvent element, std::chrono::nanoseconds time,
+                          const std::vector<std::string> &aircraft_ids, const std::vector<Token> &tokens) {
+    bool refused = tokens.size() != aircraft_ids.size();
+    JournalRecord header = journal_record(event, time, refused ? kJournalRefused : 0);
+    header.expiration = static_cast<int64_t>(aircraft_ids.size());
+    journal.append(header);
+    for (size_t i = 0; i < aircraft_ids.size(); ++i) {
+        if (refused) {
+            journal.append(journal_record(element, time, kJournalRefused), aircraft_ids[i]);
+        }
+        else {
+            journal.append(journal_record(element, time, static_cast<uint8_t>(tokens[i].state), 0, tokens[i]),
+                           aircraft_ids[i]);
+        }
+    }
+}
+
+/*
+ * A batch perform goes in as its size, then one record per token.
+ */
+template<typename Token>
+static void journal_batch(Journal &journal, JournalEvent event, JournalEvent element, std::chrono::nanoseconds time,
+                          const std::vector<Token> &tokens, const std::vector<bool> &started) {
+    JournalRecord header = journal_record(event, time);
+    header.expiration = static_cast<int64_t>(tokens.size());
+    journal.append(header);
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        journal.append(journal_record(element, time, started[i] ? 1 : 0, 0, tokens[i]));
+    }
+}
+
+/*
+ * Builds count Ts in a single allocation. The pointers handed out alias the block, which
+ * goes when the last of them does.
+ * @param id_of: the id of the i-th T
+ */
+template<typename T, typename IdOf>
+static std::shared_ptr<T> build_block(size_t count, IdOf id_of) {
+    T *objects = static_cast<T *>(::operator new(count * sizeof(T)));
+    size_t built = 0;
+    try {
+        for (; built < count; ++built) {
+            new (objects + built) T(id_of(built));
+        }
+    }
+    catch (...) {
+        while (built) {
+            objects[--built].~T();
+        }
+        ::operator delete(objects);
+        throw;
+    }
+    return std::shared_ptr<T>(objects, [count] (T *block) {
+        for (size_t i = 0; i < count; ++i) {
+            block[i].~T();
+        }
+        ::operator delete(block);
+    });
+}
+
+Airport::Airport() : store(std::make_shared<ResourceStore>()), scheduler(std::make_shared<TimerService>()),
+                     next_expiry_tick(kNoExpiryTick), lifeline(std::make_shared<Lifeline>()) {
+    lifeline->airport = this;
+    expiry_staging.emplace_back(new ExpiryStaging());
+}
+
+Airport::Airport(std::shared_ptr<Scheduler> scheduler) : store(std::make_shared<ResourceStore>()), scheduler(scheduler),
+                                                         next_expiry_tick(kNoExpiryTick),
+                                                         lifeline(std::make_shared<Lifeline>()) {
+    lifeline->airport = this;
+    expiry_staging.emplace_back(new ExpiryStaging());
+}
 
 Airport::~Airport() {
-    for (auto& fut : future_arr) {
-        fut.get();
+    {
+        std::lock_guard<std::mutex> guard(lifeline->l_lock);
+        lifeline->airport = nullptr;
+    }
+    wait_idle();
+    for (auto &staging : expiry_staging) {
+        ExpiryNode *node = staging->head.exchange(nullptr);
+        while (node) {
+            ExpiryNode *next = node->next;
+            delete node;
+            node = next;
+        }
     }
+    take_arrivals();        // queued waiters are dropped
+}
+
+void Airport::wait_idle() {
+    std::unique_lock<std::mutex> guard(idle_lock);
+    idle_cv.wait(guard, [this] () { return in_flight.load() == 0; });
 }
 
 /*
- * @param rw: a Runway ptr
- * @param ps: a ParkingStand ptr
+ * Available -> Reserved on both resources, lock-free. Rolls the runway back if the stand is gone.
+ * @param rw_idx: a runway handle
+ * @param ps_idx: a parking stand handle
+ * @param epoch: receives the runway reservation epoch
  * @return : if success or not
  */
-bool Airport::reserve_landing_resource(std::shared_ptr<Runway> rw, std::shared_ptr<ParkingStand> ps) {
-    if (std::try_lock(rw->r_lock, ps->p_lock) == -1) {
-        if (ps->getState() == ParkingStandState::Available &&
-            rw->getState() == RunwayState::Available) {
-            rw->setState(RunwayState::Reserved);
-            ps->setState(ParkingStandState::Reserved);
-            return true;
-        }
-        rw->r_lock.unlock();
-        ps->p_lock.unlock();
+bool Airport::reserve_landing_resource(ResourceHandle rw_idx, ResourceHandle ps_idx, uint32_t &epoch) {
+    std::atomic<uint32_t> &rw = store->runway_state(rw_idx);
+    if (!Runway::reserve(rw, epoch)) {
+        collector.runway_reserve_failed(rw_idx);
+        TRACE_INSTANT(ReserveFailed, rw_idx, ps_idx, 0);
+        return false;
     }
-    return false;
+    if (!ParkingStand::transition(store->parking_stand_state(ps_idx),
+                                  ParkingStandState::Available, ParkingStandState::Reserved)) {
+        collector.parking_stand_reserve_failed(ps_idx);
+        TRACE_INSTANT(ReserveFailed, rw_idx, ps_idx, 1);
+        Runway::transition(rw, epoch, RunwayState::Reserved, RunwayState::Available);
+        return false;
+    }
+    TRACE_INSTANT(Reserve, rw_idx, ps_idx, epoch);
+    return true;
 }
 
 /*
- * @param rw: a Runway ptr
- * @param ps: a ParkingStand ptr
+ * Runway Available -> Reserved and stand Occupied -> Available, lock-free.
+ * @param rw_idx: a runway handle
+ * @param ps_idx: a parking stand handle
+ * @param epoch: receives the runway reservation epoch
  * @return : if success or not
  */
-bool Airport::reserve_takeoff_resource(std::shared_ptr<Runway> rw, std::shared_ptr<ParkingStand> ps) {
-    if (try_lock(rw->r_lock, ps->p_lock) == -1) {
-        if (ps->getState() == ParkingStandState::Occupied &&
-            rw->getState() == RunwayState::Available) {
-            rw->setState(RunwayState::Reserved);
-            ps->setState(ParkingStandState::Available);
-            return true;
+bool Airport::reserve_takeoff_resource(ResourceHandle rw_idx, ResourceHandle ps_idx, uint32_t &epoch) {
+    std::atomic<uint32_t> &rw = store->runway_state(rw_idx);
+    if (!Runway::reserve(rw, epoch)) {
+        collector.runway_reserve_failed(rw_idx);
+        TRACE_INSTANT(ReserveFailed, rw_idx, ps_idx, 0);
+        return false;
+    }
+    if (!ParkingStand::transition(store->parking_stand_state(ps_idx),
+                                  ParkingStandState::Occupied, ParkingStandState::Available)) {
+        collector.parking_stand_reserve_failed(ps_idx);
+        TRACE_INSTANT(ReserveFailed, rw_idx, ps_idx, 1);
+        Runway::transition(rw, epoch, RunwayState::Reserved, RunwayState::Available);
+        return false;
+    }
+    TRACE_INSTANT(Reserve, rw_idx, ps_idx, epoch);
+    return true;
+}
+
+/*
+ * Puts a runway back into the free index once it is Available again.
+ */
+void Airport::release_runway(uint32_t rw_idx) {
+    free_runways.push(rw_idx);
+}
+
+void Airport::release_parking_stand(uint32_t ps_idx) {
+    free_parking_stands.push(ps_idx);
+}
+
+std::chrono::nanoseconds Airport::now() {
+    return scheduler->now();
+}
+
+/*
+ * Runs fn after delay on the scheduler and counts it as in flight until it is done.
+ */
+void Airport::run_after(std::chrono::nanoseconds delay, std::function<void()> fn) {
+    ++in_flight;
+    scheduler->schedule_after(delay, [this, fn] () {
+        fn();
+        operation_done();
+    });
+}
+
+/*
+ * The count is dropped under idle_lock, so wait_idle() cannot return (and the airport
+ * cannot be destroyed) while the work is still touching it.
+ */
+void Airport::operation_done() {
+    std::lock_guard<std::mutex> guard(idle_lock);
+    if (--in_flight == 0) {
+        idle_cv.notify_all();
+    }
+}
+
+/*
+ * The runway is still InOperation, so its aircraft is read before the runway goes back.
+ */
+void Airport::complete_landing(uint32_t rw_idx, uint32_t ps_idx) {
+    TRACE_SCOPE(CompleteLanding, rw_idx, ps_idx);
+    if (journal) {
+        journal->append(journal_record(JournalEvent::CompleteLanding, now(), 0, 0, rw_idx, ps_idx));
+    }
+    const std::string &aircraft_id = store->runway_aircraft(rw_idx);
+    parking_info.insert(aircraft_id, ps_idx);
+    if (log_movements) {
+        Logger::instance().log("Aircraft ID: ", aircraft_id, ", Parking ID: ", store->parking_stand_id(ps_idx), '\n');
+    }
+    store->parking_stand_state(ps_idx) = static_cast<uint8_t>(ParkingStandState::Occupied);
+    Runway::setState(store->runway_state(rw_idx), RunwayState::Available);
+    release_runway(rw_idx);
+    dispatch_waiters();
+}
+
+void Airport::complete_takeoff(uint32_t rw_idx, uint32_t ps_idx) {
+    TRACE_SCOPE(CompleteTakeoff, rw_idx, ps_idx);
+    if (journal) {
+        journal->append(journal_record(JournalEvent::CompleteTakeoff, now(), 0, 0, rw_idx, ps_idx));
+    }
+    const std::string &aircraft_id = store->runway_aircraft(rw_idx);
+    parking_info.erase(aircraft_id);
+    if (log_movements) {
+        Logger::instance().log("Aircraft ID: ", aircraft_id, ", Parking ID: ", store->parking_stand_id(ps_idx),
+                               ", took off\n");
+    }
+    store->parking_stand_state(ps_idx) = static_cast<uint8_t>(ParkingStandState::Available);
+    Runway::setState(store->runway_state(rw_idx), RunwayState::Available);
+    release_runway(rw_idx);
+    release_parking_stand(ps_idx);
+    dispatch_waiters();
+}
+
+void Airport::complete_landings(const std::vector<Movement> &movements) {
+    TRACE_SCOPE(CompleteLandings, static_cast<uint32_t>(movements.size()));
+    if (journal) {
+        std::chrono::nanoseconds time = now();
+        for (auto &movement : movements) {
+            journal->append(journal_record(JournalEvent::CompleteLanding, time, 0, 0, movement.rw_idx,
+                                           movement.ps_idx));
         }
-        rw->r_lock.unlock();
-        ps->p_lock.unlock();
     }
-    return false;
+    std::vector<uint32_t> rw_free;
+    rw_free.reserve(movements.size());
+    for (auto &movement : movements) {
+        const std::string &aircraft_id = store->runway_aircraft(movement.rw_idx);
+        parking_info.insert(aircraft_id, movement.ps_idx);
+        if (log_movements) {
+            Logger::instance().log("Aircraft ID: ", aircraft_id, ", Parking ID: ",
+                                   store->parking_stand_id(movement.ps_idx), '\n');
+        }
+        store->parking_stand_state(movement.ps_idx) = static_cast<uint8_t>(ParkingStandState::Occupied);
+        Runway::setState(store->runway_state(movement.rw_idx), RunwayState::Available);
+        rw_free.push_back(movement.rw_idx);
+    }
+    free_runways.push_many(rw_free);
+    dispatch_waiters();
 }
 
+void Airport::complete_takeoffs(const std::vector<Movement> &movements) {
+    TRACE_SCOPE(CompleteTakeoffs, static_cast<uint32_t>(movements.size()));
+    if (journal) {
+        std::chrono::nanoseconds time = now();
+        for (auto &movement : movements) {
+            journal->append(journal_record(JournalEvent::CompleteTakeoff, time, 0, 0, movement.rw_idx,
+                                           movement.ps_idx));
+        }
+    }
+    std::vector<uint32_t> rw_free, ps_free;
+    rw_free.reserve(movements.size());
+    ps_free.reserve(movements.size());
+    for (auto &movement : movements) {
+        const std::string &aircraft_id = store->runway_aircraft(movement.rw_idx);
+        parking_info.erase(aircraft_id);
+        if (log_movements) {
+            Logger::instance().log("Aircraft ID: ", aircraft_id, ", Parking ID: ",
+                                   store->parking_stand_id(movement.ps_idx), ", took off\n");
+        }
+        store->parking_stand_state(movement.ps_idx) = static_cast<uint8_t>(ParkingStandState::Available);
+        Runway::setState(store->runway_state(movement.rw_idx), RunwayState::Available);
+        rw_free.push_back(movement.rw_idx);
+        ps_free.push_back(movement.ps_idx);
+    }
+    free_runways.push_many(rw_free);
+    free_parking_stands.push_many(ps_free);
+    dispatch_waiters();
+}
+
+/*
+ * Remembers a Proceed token so its reservation is reclaimed once the token lapses.
+ */
+void Airport::track_expiry(std::chrono::nanoseconds time, std::chrono::nanoseconds expiration,
+                           const ReservationExpiry &reservation) {
+    track_expiry(time, expiration, &reservation, 1);
+}
+
+/*
+ * Remembers a wave of Proceed tokens sharing one expiration. They go onto the calling thread's
+ * shard's staging list with one CAS and only reach the wheel on the next tick, so the request
+ * path takes no lock and threads on different shards do not share a head. A tick is only
+ * scheduled if this expiry comes before every tick already scheduled.
+ * @param time: the clock read the expiration was worked out from
+ */
+void Airport::track_expiry(std::chrono::nanoseconds time, std::chrono::nanoseconds expiration,
+                           const ReservationExpiry *reservations, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    // A token is still valid at its expiration, so it lapses on the tick after.
+    uint64_t deadline = expiry_tick_of(expiration) + 1;
+    ExpiryNode *first = nullptr, *last = nullptr;
+    try {
+        for (size_t i = 0; i < count; ++i) {
+            first = new ExpiryNode {first, deadline, reservations[i]};
+            if (!last) {
+                last = first;
+            }
+        }
+    }
+    catch (...) {
+        while (first) {
+            ExpiryNode *next = first->next;
+            delete first;
+            first = next;
+        }
+        throw;
+    }
+    std::atomic<ExpiryNode *> &staging = expiry_staging[free_runways.local_shard()]->head;
+    last->next = staging.load();
+    while (!staging.compare_exchange_weak(last->next, first)) {
+    }
+    uint64_t scheduled = next_expiry_tick.load();
+    while (deadline < scheduled) {
+        if (next_expiry_tick.compare_exchange_weak(scheduled, deadline)) {
+            schedule_expiry_tick(deadline, time);
+            break;
+        }
+    }
+}
+
+/*
+ * Schedules a wheel tick. Ticks are only scheduled for the wheel's next deadline, so an
+ * airport with nothing to expire schedules nothing and an idle SimEngine still runs dry.
+ * The tick only holds l_lock to pin the airport as an operation in flight, which ~Airport
+ * waits for; resources go back and waiters are granted after l_lock is dropped.
+ * @param time: a recent clock read, to turn the tick into a delay
+ */
+void Airport::schedule_expiry_tick(uint64_t tick, std::chrono::nanoseconds time) {
+    std::chrono::nanoseconds at = kExpiryTick * static_cast<int64_t>(tick);
+    std::shared_ptr<Lifeline> life = lifeline;
+    scheduler->schedule_after(at - time, [life, tick] () {
+        Airport *airport;
+        {
+            std::lock_guard<std::mutex> guard(life->l_lock);
+            airport = life->airport;
+            if (!airport) {
+                return;
+            }
+            ++airport->in_flight;
+        }
+        airport->expire_tokens(tick);
+        airport->operation_done();
+    });
+}
+
+/*
+ * Moves every shard's staged reservations into the wheel, advances it to the current tick and hands back
+ * every lapsed reservation that was never performed. The epoch check leaves runways alone once
+ * they have moved on. A tick that was superseded by an earlier one only advances the wheel, so
+ * ticks do not multiply.
+ * @param scheduled_tick: the tick this run was scheduled for
+ */
+void Airport::expire_tokens(uint64_t scheduled_tick) {
+    TRACE_SCOPE(ExpireTokens);
+    // Given up before the staging list is taken: whatever is staged after that sees no tick
+    // coming and schedules its own.
+    next_expiry_tick.compare_exchange_strong(scheduled_tick, kNoExpiryTick);
+    std::chrono::nanoseconds time = now();
+    uint64_t tick = expiry_tick_of(time);
+    std::vector<ReservationExpiry> due;
+    uint64_t next;
+    {
+        std::lock_guard<std::mutex> guard(expiry_lock);
+        expiry_wheel.advance(tick, due);
+        for (auto &staging : expiry_staging) {
+            ExpiryNode *node = nullptr;
+            for (ExpiryNode *staged = staging->head.exchange(nullptr); staged; ) {     // oldest first
+                ExpiryNode *next_staged = staged->next;
+                staged->next = node;
+                node = staged;
+                staged = next_staged;
+            }
+            while (node) {
+                if (node->deadline <= tick) {
+                    due.push_back(node->reservation);
+                }
+                else {
+                    expiry_wheel.insert(node->deadline, node->reservation);
+                }
+                ExpiryNode *staged = node->next;
+                delete node;
+                node = staged;
+            }
+        }
+        next = expiry_wheel.next_due();
+    }
+    bool schedule = false;
+    uint64_t scheduled = next_expiry_tick.load();
+    while (next < scheduled) {
+        if (next_expiry_tick.compare_exchange_weak(scheduled, next)) {
+            schedule = true;
+            break;
+        }
+    }
+    for (auto &reservation : due) {
+        if (!Runway::transition(store->runway_state(reservation.rw_idx), reservation.epoch,
+                                RunwayState::Reserved, RunwayState::Available)) {
+            continue;
+        }
+        TRACE_INSTANT(Expire, reservation.rw_idx, reservation.ps_idx, reservation.epoch);
+        if (journal) {
+            journal->append(journal_record(JournalEvent::Expire, time, 0, reservation.takeoff ? kJournalTakeoff : 0,
+                                           reservation.rw_idx, reservation.ps_idx, reservation.epoch));
+        }
+        std::atomic<uint8_t> &ps = store->parking_stand_state(reservation.ps_idx);
+        if (reservation.takeoff) {
+            ps = static_cast<uint8_t>(ParkingStandState::Occupied);     // the aircraft never left
+        }
+        else {
+            ps = static_cast<uint8_t>(ParkingStandState::Available);
+            release_parking_stand(reservation.ps_idx);
+        }
+        release_runway(reservation.rw_idx);
+    }
+    if (!due.empty()) {
+        dispatch_waiters();
+    }
+    if (schedule) {
+        schedule_expiry_tick(next, time);
+    }
+}
+
+void Airport::set_shards(unsigned count) {
+    if (store->runway_count() || store->parking_stand_count()) {
+        throw std::runtime_error("Shards must be set before adding resources");
+    }
+    free_runways.reset(count);
+    free_parking_stands.reset(count);
+    expiry_staging.clear();         // nothing is staged without resources
+    for (unsigned i = 0; i < free_runways.shard_count(); ++i) {
+        expiry_staging.emplace_back(new ExpiryStaging());
+    }
+}
+
+/*
+ * Only runways with a reservation or an operation keep their aircraft; the rest is stale.
+ */
+void Airport::snapshot(const std::string &path) {
+    if (waiting.load() != 0) {
+        throw std::runtime_error("Cannot snapshot an airport with clients waiting");
+    }
+    size_t num_rw = store->runway_count();
+    size_t num_ps = store->parking_stand_count();
+    std::vector<uint32_t> rw_states(num_rw);
+    std::vector<uint64_t> rw_holders(num_rw);
+    std::vector<int64_t> rw_times(num_rw);
+    std::vector<uint8_t> ps_states(num_ps);
+    std::vector<uint32_t> parked_stands;
+    std::vector<uint64_t> string_ends;
+    std::string string_data;
+    auto add_string = [&string_ends, &string_data] (const std::string &s) {
+        string_data += s;
+        string_ends.push_back(string_data.size());
+    };
+
+    for (uint32_t rw_idx = 0; rw_idx < num_rw; ++rw_idx) {
+        rw_states[rw_idx] = store->runway_state(rw_idx).load();
+        rw_holders[rw_idx] = store->runway_holder(rw_idx).load();
+        rw_times[rw_idx] = store->runway_time(rw_idx);
+        add_string(store->runway_id(rw_idx));
+    }
+    for (uint32_t ps_idx = 0; ps_idx < num_ps; ++ps_idx) {
+        ps_states[ps_idx] = store->parking_stand_state(ps_idx).load();
+        add_string(store->parking_stand_id(ps_idx));
+    }
+    for (uint32_t rw_idx = 0; rw_idx < num_rw; ++rw_idx) {
+        bool held = Runway::state_of(rw_states[rw_idx]) != RunwayState::Available;
+        add_string(held ? store->runway_aircraft(rw_idx) : std::string());
+    }
+    parking_info.for_each([&parked_stands, &add_string] (const std::string &aircraft_id, ResourceHandle ps_idx) {
+        parked_stands.push_back(ps_idx);
+        add_string(aircraft_id);
+    });
+
+    SnapshotWriter writer;
+    SnapshotHeader &h = writer.header();
+    h.runways = num_rw;
+    h.parking_stands = num_ps;
+    h.parked = parked_stands.size();
+    h.saved_at = now().count();
+    h.operation_duration = operation_duration.count();
+    h.token_validity = token_validity.count();
+    h.runway_states = writer.append(rw_states.data(), num_rw * sizeof(uint32_t));
+    h.runway_holders = writer.append(rw_holders.data(), num_rw * sizeof(uint64_t));
+    h.runway_times = writer.append(rw_times.data(), num_rw * sizeof(int64_t));
+    h.parking_stand_states = writer.append(ps_states.data(), num_ps);
+    h.parked_stands = writer.append(parked_stands.data(), parked_stands.size() * sizeof(uint32_t));
+    h.string_ends = writer.append(string_ends.data(), string_ends.size() * sizeof(uint64_t));
+    h.string_data = writer.append(string_data.data(), string_data.size());
+    writer.write(path);
+}
+
+/*
+ * The arrays are used where they lie in the mapping, the Runway and ParkingStand objects are
+ * built in one block per kind, as by load_layout(), and the id maps are left to the first
+ * lookup, hashing every id being most of the work otherwise. A takeoff's stand is already Available
+ * while its runway is held, but only goes back to the free index when the takeoff completes.
+ */
+void Airport::restore(const std::string &path) {
+    if (store->runway_count() || store->parking_stand_count()) {
+        throw std::runtime_error("Restore needs an airport without resources");
+    }
+    MappedFile file(path);
+    const SnapshotHeader &h = snapshot_header(file);
+    const uint32_t *rw_states = file.array<uint32_t>(h.runway_states, h.runways);
+    const uint64_t *rw_holders = file.array<uint64_t>(h.runway_holders, h.runways);
+    const int64_t *rw_times = file.array<int64_t>(h.runway_times, h.runways);
+    const uint8_t *ps_states = file.array<uint8_t>(h.parking_stand_states, h.parking_stands);
+    const uint32_t *parked_stands = file.array<uint32_t>(h.parked_stands, h.parked);
+    uint64_t strings = 2 * h.runways + h.parking_stands + h.parked;
+    const uint64_t *string_ends = file.array<uint64_t>(h.string_ends, strings);
+    // Ends that never go down and a last one inside the file keep every string in the data.
+    for (uint64_t i = 1; i < strings; ++i) {
+        if (string_ends[i] < string_ends[i - 1]) {
+            throw std::runtime_error("Snapshot is corrupt");
+        }
+    }
+    const char *string_data = file.array<char>(h.string_data, strings ? string_ends[strings - 1] : 0);
+    auto string_at = [string_ends, string_data] (uint64_t i) {
+        uint64_t begin = i ? string_ends[i - 1] : 0;
+        return std::string(string_data + begin, string_ends[i] - begin);
+    };
+    std::vector<bool> takeoff_stands(h.parking_stands, false);
+    for (uint64_t rw_idx = 0; rw_idx < h.runways; ++rw_idx) {
+        uint32_t ps_idx = static_cast<uint32_t>(rw_holders[rw_idx]);
+        if ((rw_states[rw_idx] & 0xFF) > static_cast<uint32_t>(RunwayState::Available)) {
+            throw std::runtime_error("Snapshot is corrupt");    // in no free index and never expired
+        }
+        if (Runway::state_of(rw_states[rw_idx]) == RunwayState::Available) {
+            continue;
+        }
+        if (ps_idx >= h.parking_stands) {
+            throw std::runtime_error("Snapshot is corrupt");
+        }
+        if (static_cast<uint8_t>(rw_holders[rw_idx] >> 32) == kTakeoffHolder) {
+            takeoff_stands[ps_idx] = true;
+        }
+    }
+    for (uint64_t ps_idx = 0; ps_idx < h.parking_stands; ++ps_idx) {
+        if (ps_states[ps_idx] > static_cast<uint8_t>(ParkingStandState::Available)) {
+            throw std::runtime_error("Snapshot is corrupt");
+        }
+    }
+    for (uint64_t i = 0; i < h.parked; ++i) {
+        if (parked_stands[i] >= h.parking_stands) {
+            throw std::runtime_error("Snapshot is corrupt");
+        }
+    }
+
+    std::chrono::nanoseconds restored_at = now();
+    std::chrono::nanoseconds shift = restored_at - std::chrono::nanoseconds(h.saved_at);
+    operation_duration = std::chrono::nanoseconds(h.operation_duration);
+    token_validity = std::chrono::nanoseconds(h.token_validity);
+    store->reserve(h.runways, h.parking_stands);
+    runways.reserve(h.runways);
+    parking_stands.reserve(h.parking_stands);
+    parking_info.reserve(h.parked);
+
+    std::shared_ptr<Runway> rw_block = build_block<Runway>(h.runways, string_at);
+    for (uint32_t rw_idx = 0; rw_idx < h.runways; ++rw_idx) {
+        std::shared_ptr<Runway> runway(rw_block, rw_block.get() + rw_idx);
+        store->add_runway(runway->getRunway_id(), rw_states[rw_idx]);
+        store->runway_holder(rw_idx) = rw_holders[rw_idx];
+        store->runway_time(rw_idx) = rw_times[rw_idx] + shift.count();
+        store->runway_aircraft(rw_idx) = string_at(h.runways + h.parking_stands + rw_idx);
+        runway->attach(store, rw_idx);
+        runways.push_back(runway);
+        collector.add_runway();
+        free_runways.add(rw_idx % free_runways.shard_count());
+        if (Runway::state_of(rw_states[rw_idx]) == RunwayState::Available) {
+            release_runway(rw_idx);
+        }
+    }
+    uint64_t ps_strings = h.runways;
+    std::shared_ptr<ParkingStand> ps_block = build_block<ParkingStand>(h.parking_stands,
+                                                                       [&string_at, ps_strings] (size_t i) {
+        return string_at(ps_strings + i);
+    });
+    for (uint32_t ps_idx = 0; ps_idx < h.parking_stands; ++ps_idx) {
+        std::shared_ptr<ParkingStand> parking_stand(ps_block, ps_block.get() + ps_idx);
+        store->add_parking_stand(parking_stand->getParking_id(), ps_states[ps_idx]);
+        parking_stand->attach(store, ps_idx);
+        parking_stands.push_back(parking_stand);
+        collector.add_parking_stand();
+        free_parking_stands.add(ps_idx % free_parking_stands.shard_count());
+        if (ps_states[ps_idx] == static_cast<uint8_t>(ParkingStandState::Available) && !takeoff_stands[ps_idx]) {
+            release_parking_stand(ps_idx);
+        }
+    }
+    ids_pending = true;
+    for (uint64_t i = 0; i < h.parked; ++i) {
+        parking_info.insert(string_at(2 * h.runways + h.parking_stands + i), parked_stands[i]);
+    }
+
+    for (uint32_t rw_idx = 0; rw_idx < h.runways; ++rw_idx) {
+        uint32_t word = rw_states[rw_idx];
+        uint32_t ps_idx = static_cast<uint32_t>(rw_holders[rw_idx]);
+        bool takeoff = static_cast<uint8_t>(rw_holders[rw_idx] >> 32) == kTakeoffHolder;
+        std::chrono::nanoseconds time(store->runway_time(rw_idx));
+        if (Runway::state_of(word) == RunwayState::Reserved) {
+            track_expiry(restored_at, time, ReservationExpiry {rw_idx, ps_idx, word >> 8, takeoff});
+        }
+        else if (Runway::state_of(word) == RunwayState::InOperation) {
+            run_after(std::max(time - restored_at, std::chrono::nanoseconds::zero()), [this, rw_idx, ps_idx, takeoff] () {
+                if (takeoff) {
+                    complete_takeoff(rw_idx, ps_idx);
+                }
+                else {
+                    complete_landing(rw_idx, ps_idx);
+                }
+            });
+        }
+    }
+}
+
+/*
+ * Builds the id maps that restore() and load_layout() skipped. Later additions index their own ids.
+ */
+void Airport::index_ids() const {
+    if (!ids_pending.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(ids_lock);
+    if (!ids_pending.load(std::memory_order_relaxed)) {
+        return;
+    }
+    runway_map.reserve(store->runway_count());
+    for (uint32_t rw_idx = 0; rw_idx < store->runway_count(); ++rw_idx) {
+        runway_map.insert(make_pair(store->runway_id(rw_idx), rw_idx));
+    }
+    parking_stand_map.reserve(store->parking_stand_count());
+    for (uint32_t ps_idx = 0; ps_idx < store->parking_stand_count(); ++ps_idx) {
+        parking_stand_map.insert(make_pair(store->parking_stand_id(ps_idx), ps_idx));
+    }
+    ids_pending.store(false, std::memory_order_release);
+}
+
+ResourceHandle Airport::find_runway(const std::string &runway_id) const {
+    index_ids();
+    auto got = runway_map.find(runway_id);
+    return got == runway_map.end() ? kInvalidHandle : got->second;
+}
+
+ResourceHandle Airport::find_parking_stand(const std::string &parking_id) const {
+    index_ids();
+    auto got = parking_stand_map.find(parking_id);
+    return got == parking_stand_map.end() ? kInvalidHandle : got->second;
+}
+
+/*
+ * Shards are dealt out round-robin unless the caller picks one.
+ */
 void Airport::add_runway(std::shared_ptr<Runway> runway) {
+    add_runway(runway, static_cast<unsigned>(store->runway_count() % free_runways.shard_count()));
+}
+
+void Airport::add_runway(std::shared_ptr<Runway> runway, unsigned shard) {
+    if (runway->attached()) {
+        throw std::runtime_error("Runway already belongs to an airport");
+    }
+    if (shard >= free_runways.shard_count()) {
+        throw std::runtime_error("This airport does not have this shard");
+    }
+    index_ids();
+    ResourceHandle rw_idx = store->add_runway(runway->getRunway_id(), runway->state_word());
+    runway->attach(store, rw_idx);
     runways.push_back(runway);
-    runway_map.insert(make_pair(runway->getRunway_id(), runway));
+    collector.add_runway();
+    free_runways.add(shard);
+    runway_map.insert(make_pair(runway->getRunway_id(), rw_idx));
+    if (runway->getState() == RunwayState::Available) {
+        release_runway(rw_idx);
+    }
 }
 
 void Airport::add_parking_stands(std::shared_ptr<ParkingStand> parking_stand) {
+    add_parking_stands(parking_stand,
+                       static_cast<unsigned>(store->parking_stand_count() % free_parking_stands.shard_count()));
+}
+
+void Airport::add_parking_stands(std::shared_ptr<ParkingStand> parking_stand, unsigned shard) {
+    if (parking_stand->attached()) {
+        throw std::runtime_error("Parking stand already belongs to an airport");
+    }
+    if (shard >= free_parking_stands.shard_count()) {
+        throw std::runtime_error("This airport does not have this shard");
+    }
+    index_ids();
+    ResourceHandle ps_idx = store->add_parking_stand(parking_stand->getParking_id(),
+                                                     static_cast<uint8_t>(parking_stand->getState()));
+    parking_stand->attach(store, ps_idx);
     parking_stands.push_back(parking_stand);
-    parking_stand_map.insert(make_pair(parking_stand->getParking_id(), parking_stand));
+    collector.add_parking_stand();
+    free_parking_stands.add(shard);
+    parking_stand_map.insert(make_pair(parking_stand->getParking_id(), ps_idx));
+    if (parking_stand->getState() == ParkingStandState::Available) {
+        release_parking_stand(ps_idx);
+    }
 }
 
-LandingRequestToken Airport::request_landing(std::string aircraft_id) {
-    for (auto& ps : parking_stands) {
-        for (auto& rw : runways) {
-            if (reserve_landing_resource(rw, ps)) {
-                return LandingRequestToken(AirportState::Proceed, aircraft_id,
-                                           rw->getRunway_id(), ps->getParking_id(), 4);
-            }
+/*
+ * @return : the shard each id goes to, as add_* deals them out from base on; throws if one is
+ *           out of range
+ */
+static std::vector<unsigned> layout_shards(const LayoutIds &ids, size_t base, unsigned shard_count) {
+    std::vector<unsigned> shards(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        shards[i] = ids.shard(i) == kAnyShard ? static_cast<unsigned>((base + i) % shard_count) : ids.shard(i);
+        if (shards[i] >= shard_count) {
+            throw std::runtime_error("This airport does not have this shard");
         }
     }
+    return shards;
+}
+
+/*
+ * The resources are freed last in one push per shard, in reverse, so the stacks come out as
+ * they would after one add_* per resource.
+ */
+void Airport::load_layout(const Layout &layout) {
+    const LayoutIds &rw_ids = layout.runways;
+    const LayoutIds &ps_ids = layout.parking_stands;
+    size_t rw_base = store->runway_count();
+    size_t ps_base = store->parking_stand_count();
+    std::vector<unsigned> rw_shards = layout_shards(rw_ids, rw_base, free_runways.shard_count());
+    std::vector<unsigned> ps_shards = layout_shards(ps_ids, ps_base, free_parking_stands.shard_count());
+    index_ids();
+    store->reserve(rw_base + rw_ids.size(), ps_base + ps_ids.size());
+    runways.reserve(rw_base + rw_ids.size());
+    parking_stands.reserve(ps_base + ps_ids.size());
+    free_runways.reserve(rw_base + rw_ids.size());
+    free_parking_stands.reserve(ps_base + ps_ids.size());
+
+    std::vector<uint32_t> freed;
+    freed.reserve(std::max(rw_ids.size(), ps_ids.size()));
+    std::shared_ptr<Runway> rw_block = build_block<Runway>(rw_ids.size(), [&rw_ids] (size_t i) {
+        return rw_ids.id(i);
+    });
+    for (size_t i = 0; i < rw_ids.size(); ++i) {
+        std::shared_ptr<Runway> runway(rw_block, rw_block.get() + i);
+        ResourceHandle rw_idx = store->add_runway(runway->getRunway_id(), runway->state_word());
+        runway->attach(store, rw_idx);
+        runways.push_back(runway);
+        collector.add_runway();
+        free_runways.add(rw_shards[i]);
+        freed.push_back(rw_idx);
+    }
+    std::reverse(freed.begin(), freed.end());
+    free_runways.push_many(freed);
+
+    freed.clear();
+    std::shared_ptr<ParkingStand> ps_block = build_block<ParkingStand>(ps_ids.size(), [&ps_ids] (size_t i) {
+        return ps_ids.id(i);
+    });
+    for (size_t i = 0; i < ps_ids.size(); ++i) {
+        std::shared_ptr<ParkingStand> parking_stand(ps_block, ps_block.get() + i);
+        ResourceHandle ps_idx = store->add_parking_stand(parking_stand->getParking_id(),
+                                                         static_cast<uint8_t>(parking_stand->getState()));
+        parking_stand->attach(store, ps_idx);
+        parking_stands.push_back(parking_stand);
+        collector.add_parking_stand();
+        free_parking_stands.add(ps_shards[i]);
+        freed.push_back(ps_idx);
+    }
+    std::reverse(freed.begin(), freed.end());
+    free_parking_stands.push_many(freed);
+    ids_pending = true;
+}
+
+LandingRequestToken Airport::request_landing(std::string aircraft_id, LandingPriority priority) {
+    if (!journal) {
+        return reserve_landing(aircraft_id, priority);
+    }
+    std::chrono::nanoseconds time = now();
+    LandingRequestToken token = reserve_landing(aircraft_id, priority);
+    journal->append(journal_record(JournalEvent::RequestLanding, time, static_cast<uint8_t>(token.state),
+                                   static_cast<uint8_t>(priority), token), aircraft_id);
+    return token;
+}
+
+TakeOffRequestToken Airport::request_takeoff(std::string aircraft_id) {
+    if (!journal) {
+        return reserve_takeoff(aircraft_id);
+    }
+    std::chrono::nanoseconds time = now();
+    TakeOffRequestToken token;
+    try {
+        token = reserve_takeoff(aircraft_id);
+    }
+    catch (std::runtime_error &) {
+        journal->append(journal_record(JournalEvent::RequestTakeoff, time, kJournalRefused), aircraft_id);
+        throw;
+    }
+    journal->append(journal_record(JournalEvent::RequestTakeoff, time, static_cast<uint8_t>(token.state), 0, token),
+                    aircraft_id);
+    return token;
+}
+
+bool Airport::perform_landing(LandingRequestToken token) {
+    if (!journal) {
+        return start_landing(token);
+    }
+    std::chrono::nanoseconds time = now();
+    try {
+        start_landing(token);
+    }
+    catch (std::runtime_error &) {
+        journal->append(journal_record(JournalEvent::PerformLanding, time, 0, 0, token));
+        throw;
+    }
+    journal->append(journal_record(JournalEvent::PerformLanding, time, 1, 0, token));
+    return true;
+}
+
+bool Airport::perform_takeoff(TakeOffRequestToken token) {
+    if (!journal) {
+        return start_takeoff(token);
+    }
+    std::chrono::nanoseconds time = now();
+    try {
+        start_takeoff(token);
+    }
+    catch (std::runtime_error &) {
+        journal->append(journal_record(JournalEvent::PerformTakeoff, time, 0, 0, token));
+        throw;
+    }
+    journal->append(journal_record(JournalEvent::PerformTakeoff, time, 1, 0, token));
+    return true;
+}
+
+/*
+ * Pops one free runway and one free parking stand, so a busy airport answers Hold
+ * without touching any resource.
+ * @param aircraft_id: unique id of aircraft
+ * @return : a token either Proceed or Hold
+ */
+LandingRequestToken Airport::reserve_landing(const std::string &aircraft_id, LandingPriority priority) {
+    ScopedLatency timed(collector, StatsOp::RequestLanding);
+    TRACE_SCOPE(RequestLanding, static_cast<uint32_t>(priority));
+    uint32_t rw_idx, ps_idx;
+    if (!free_runways.pop(rw_idx)) {
+        return preempt_landing(aircraft_id, priority);
+    }
+    if (!free_parking_stands.pop(ps_idx, free_runways.home_of(rw_idx))) {
+        release_runway(rw_idx);
+        dispatch_waiters();     // a takeoff waiter may have missed the runway meanwhile
+        return preempt_landing(aircraft_id, priority);
+    }
+    uint32_t epoch;
+    if (reserve_landing_resource(rw_idx, ps_idx, epoch)) {
+        std::chrono::nanoseconds time = now();
+        std::chrono::nanoseconds expiration = time + token_validity;
+        store->set_runway_aircraft(rw_idx, aircraft_id);
+        store->runway_time(rw_idx) = expiration.count();
+        store->runway_holder(rw_idx).store(runway_holder(epoch, static_cast<uint8_t>(priority), ps_idx),
+                                           std::memory_order_release);
+        track_expiry(time, expiration, ReservationExpiry {rw_idx, ps_idx, epoch, false});
+        return LandingRequestToken(AirportState::Proceed, rw_idx, ps_idx, expiration, epoch);
+    }
+    // The state was changed behind the airport's back; only keep what is still usable.
+    if (Runway::state_of(store->runway_state(rw_idx)) == RunwayState::Available) {
+        release_runway(rw_idx);
+    }
+    if (store->parking_stand_state(ps_idx) == static_cast<uint8_t>(ParkingStandState::Available)) {
+        release_parking_stand(ps_idx);
+    }
+    dispatch_waiters();
     return LandingRequestToken(AirportState::Hold);
 }
 
@@ -74,75 +950,582 @@ LandingRequestToken Airport::request_landing(std::string aircraft_id) {
  * @param aircraft_id: unique id of aircraft
  * @return : a token either Proceed or Hold
  */
-TakeOffRequestToken Airport::request_takeoff(std::string aircraft_id) {
-    auto got = parking_info.find(aircraft_id);
-    if (got == parking_info.end()) {
+TakeOffRequestToken Airport::reserve_takeoff(const std::string &aircraft_id) {
+    ScopedLatency timed(collector, StatsOp::RequestTakeoff);
+    TRACE_SCOPE(RequestTakeoff);
+    ResourceHandle ps_idx;
+    if (!parking_info.find(aircraft_id, ps_idx)) {
         throw std::runtime_error("This airport does not have this plane");
     }
-    std::shared_ptr<ParkingStand> ps = parking_info[aircraft_id];
-    for (auto& rw : runways) {
-        if (reserve_takeoff_resource(rw, ps)) {
-            return TakeOffRequestToken(AirportState::Proceed, aircraft_id,
-                                       rw->getRunway_id(), 4);
-        }
+    uint32_t rw_idx;
+    if (!free_runways.pop(rw_idx)) {
+        return TakeOffRequestToken(AirportState::Hold);
     }
+    uint32_t epoch;
+    if (reserve_takeoff_resource(rw_idx, ps_idx, epoch)) {
+        std::chrono::nanoseconds time = now();
+        std::chrono::nanoseconds expiration = time + token_validity;
+        store->set_runway_aircraft(rw_idx, aircraft_id);
+        store->runway_time(rw_idx) = expiration.count();
+        store->runway_holder(rw_idx).store(runway_holder(epoch, kTakeoffHolder, ps_idx), std::memory_order_release);
+        track_expiry(time, expiration, ReservationExpiry {rw_idx, ps_idx, epoch, true});
+        return TakeOffRequestToken(AirportState::Proceed, rw_idx, ps_idx, expiration, epoch);
+    }
+    if (Runway::state_of(store->runway_state(rw_idx)) == RunwayState::Available) {
+        release_runway(rw_idx);
+    }
+    dispatch_waiters();
     return TakeOffRequestToken(AirportState::Hold);
 }
 
-bool Airport::perform_landing(LandingRequestToken token) {
+bool Airport::start_landing(const LandingRequestToken &token) {
+    ScopedLatency timed(collector, StatsOp::PerformLanding);
+    TRACE_SCOPE(PerformLanding, token.runway, token.parking_stand, token.epoch);
     if (token.state != AirportState::Proceed) {
         // maybe impossible path, but keep it.
         throw std::runtime_error("Invalid Input");
     }
-    std::shared_ptr<Runway> rw = runway_map[token.runway_id];
-    std::shared_ptr<ParkingStand> ps = parking_stand_map[token.parking_stand_id];
-    if (token.expiration < std::chrono::system_clock::to_time_t(std::chrono::system_clock::now())) {
-        rw->r_lock.unlock();
-        ps->p_lock.unlock();
+    uint32_t rw_idx = token.runway;
+    uint32_t ps_idx = token.parking_stand;
+    if (rw_idx >= store->runway_count() || ps_idx >= store->parking_stand_count()) {
+        throw std::runtime_error("Invalid Input");
+    }
+    std::chrono::nanoseconds time = now();
+    if (time > token.expiration) {
         throw std::runtime_error("Token was expired");
     }
+    if (!Runway::transition(store->runway_state(rw_idx), token.epoch, RunwayState::Reserved,
+                            RunwayState::InOperation)) {
+        throw std::runtime_error("Runway is not reserved");
+    }
+    store->runway_time(rw_idx) = (time + operation_duration).count();
 
-    rw->setState(RunwayState::InOperation);
-
-    std::shared_future<void> fut = async(std::launch::async, [&token, rw, ps, this] () {
-        std::this_thread::sleep_for(std::chrono::seconds(kOperationDurationSec));
-        parking_info_lock.lock();
-        parking_info.insert(make_pair(token.aircraft_id, ps));
-        parking_info_lock.unlock();
-        rw->setState(RunwayState::Available);
-        ps->setState(ParkingStandState::Occupied);
-        // Log("Aircraft ID: ", token.aircraft_id, ", Parking ID: ", token.parking_stand_id, '\n');
-        rw->r_lock.unlock();
-        ps->p_lock.unlock();
+    run_after(operation_duration, [this, rw_idx, ps_idx] () {
+        complete_landing(rw_idx, ps_idx);
     });
-    future_lock.lock();
-    future_arr.push_back(fut);
-    future_lock.unlock();
     return true;
 }
 
-bool Airport::perform_takeoff(TakeOffRequestToken token) {
-    std::shared_ptr<Runway> rw = runway_map[token.runway_id];
-    std::shared_ptr<ParkingStand> ps = parking_info[token.aircraft_id];
-    if (token.expiration < std::chrono::system_clock::to_time_t(std::chrono::system_clock::now())) {
-        rw->r_lock.unlock();
-        ps->p_lock.unlock();
+bool Airport::start_takeoff(const TakeOffRequestToken &token) {
+    ScopedLatency timed(collector, StatsOp::PerformTakeoff);
+    TRACE_SCOPE(PerformTakeoff, token.runway, token.parking_stand, token.epoch);
+    uint32_t rw_idx = token.runway;
+    uint32_t ps_idx = token.parking_stand;
+    if (rw_idx >= store->runway_count() || ps_idx >= store->parking_stand_count()) {
+        throw std::runtime_error("Invalid Input");
+    }
+    std::chrono::nanoseconds time = now();
+    if (time > token.expiration) {
         throw std::runtime_error("Token was expired");
     }
-    rw->setState(RunwayState::InOperation);
-
-    std::shared_future<void> fut = async(std::launch::async, [&token, rw, ps, this] () {
-        std::this_thread::sleep_for(std::chrono::seconds(kOperationDurationSec));
-        parking_info_lock.lock();
-        parking_info.erase(token.aircraft_id);
-        parking_info_lock.unlock();
-        rw->setState(RunwayState::Available);
-        rw->r_lock.unlock();
-        ps->setState(ParkingStandState::Available);
-        ps->p_lock.unlock();
+    if (!Runway::transition(store->runway_state(rw_idx), token.epoch, RunwayState::Reserved,
+                            RunwayState::InOperation)) {
+        throw std::runtime_error("Runway is not reserved");
+    }
+    store->runway_time(rw_idx) = (time + operation_duration).count();
+
+    run_after(operation_duration, [this, rw_idx, ps_idx] () {
+        complete_takeoff(rw_idx, ps_idx);
     });
-    future_lock.lock();
-    future_arr.push_back(fut);
-    future_lock.unlock();
     return true;
 }
+
+/*
+ * Same checks as perform_landing/perform_takeoff, but a failing token only reports false.
+ * @param time: the batch's single clock read
+ * @return : if the runway went Reserved -> InOperation
+ */
+bool Airport::start_batched(ResourceHandle rw_idx, ResourceHandle ps_idx, std::chrono::nanoseconds expiration,
+                            uint32_t epoch, std::chrono::nanoseconds time) {
+    if (rw_idx >= store->runway_count() || ps_idx >= store->parking_stand_count()) {
+        return false;
+    }
+    if (time > expiration ||
+        !Runway::transition(store->runway_state(rw_idx), epoch, RunwayState::Reserved, RunwayState::InOperation)) {
+        return false;
+    }
+    store->runway_time(rw_idx) = (time + operation_duration).count();
+    return true;
+}
+
+/*
+ * Pops as many runway/stand pairs as the wave needs in one CAS per free index. Aircraft past
+ * the last pair get Hold.
+ * @param aircraft_ids: unique ids of the aircraft in the wave
+ * @return : one token per aircraft, in order
+ */
+std::vector<LandingRequestToken> Airport::request_landing_batch(const std::vector<std::string> &aircraft_ids) {
+    std::vector<LandingRequestToken> tokens;
+    tokens.reserve(aircraft_ids.size());
+    std::vector<uint32_t> rw_idx, ps_idx, rw_spare, ps_spare;
+    free_runways.pop_many(aircraft_ids.size(), rw_idx);
+    free_parking_stands.pop_many(rw_idx.size(), ps_idx, free_runways.local_shard());
+    rw_spare.assign(rw_idx.begin() + ps_idx.size(), rw_idx.end());
+    std::chrono::nanoseconds time = now();
+    std::chrono::nanoseconds expiration = time + token_validity;
+    std::vector<ReservationExpiry> reservations;
+    reservations.reserve(ps_idx.size());
+    for (size_t i = 0; i < aircraft_ids.size(); ++i) {
+        uint32_t epoch;
+        if (i >= ps_idx.size()) {
+            tokens.emplace_back(AirportState::Hold);
+        }
+        else if (reserve_landing_resource(rw_idx[i], ps_idx[i], epoch)) {
+            store->set_runway_aircraft(rw_idx[i], aircraft_ids[i]);
+            store->runway_time(rw_idx[i]) = expiration.count();
+            store->runway_holder(rw_idx[i]).store(
+                    runway_holder(epoch, static_cast<uint8_t>(LandingPriority::Routine), ps_idx[i]),
+                    std::memory_order_release);
+            reservations.push_back(ReservationExpiry {rw_idx[i], ps_idx[i], epoch, false});
+            tokens.emplace_back(AirportState::Proceed, rw_idx[i], ps_idx[i], expiration, epoch);
+        }
+        else {
+            // Changed behind the airport's back, see request_landing().
+            if (Runway::state_of(store->runway_state(rw_idx[i])) == RunwayState::Available) {
+                rw_spare.push_back(rw_idx[i]);
+            }
+            if (store->parking_stand_state(ps_idx[i]) == static_cast<uint8_t>(ParkingStandState::Available)) {
+                ps_spare.push_back(ps_idx[i]);
+            }
+            tokens.emplace_back(AirportState::Hold);
+        }
+    }
+    free_runways.push_many(rw_spare);
+    free_parking_stands.push_many(ps_spare);
+    if (!rw_spare.empty() || !ps_spare.empty()) {
+        dispatch_waiters();
+    }
+    track_expiry(time, expiration, reservations.data(), reservations.size());
+    if (journal) {
+        journal_batch(*journal, JournalEvent::RequestLandingBatch, JournalEvent::RequestLanding,
+                      time, aircraft_ids, tokens);
+    }
+    return tokens;
+}
+
+/*
+ * Every aircraft is looked up before any runway is taken, so an unknown one throws without
+ * side effects.
+ * @param aircraft_ids: unique ids of parked aircraft
+ * @return : one token per aircraft, in order
+ */
+std::vector<TakeOffRequestToken> Airport::request_takeoff_batch(const std::vector<std::string> &aircraft_ids) {
+    std::vector<ResourceHandle> ps_idx(aircraft_ids.size());
+    for (size_t i = 0; i < aircraft_ids.size(); ++i) {
+        if (!parking_info.find(aircraft_ids[i], ps_idx[i])) {
+            if (journal) {
+                journal_batch(*journal, JournalEvent::RequestTakeoffBatch, JournalEvent::RequestTakeoff, now(),
+                              aircraft_ids, std::vector<TakeOffRequestToken>());
+            }
+            throw std::runtime_error("This airport does not have this plane");
+        }
+    }
+    std::vector<TakeOffRequestToken> tokens;
+    tokens.reserve(aircraft_ids.size());
+    std::vector<uint32_t> rw_idx, rw_spare;
+    free_runways.pop_many(aircraft_ids.size(), rw_idx);
+    std::chrono::nanoseconds time = now();
+    std::chrono::nanoseconds expiration = time + token_validity;
+    std::vector<ReservationExpiry> reservations;
+    reservations.reserve(rw_idx.size());
+    for (size_t i = 0; i < aircraft_ids.size(); ++i) {
+        uint32_t epoch;
+        if (i >= rw_idx.size()) {
+            tokens.emplace_back(AirportState::Hold);
+        }
+        else if (reserve_takeoff_resource(rw_idx[i], ps_idx[i], epoch)) {
+            store->set_runway_aircraft(rw_idx[i], aircraft_ids[i]);
+            store->runway_time(rw_idx[i]) = expiration.count();
+            store->runway_holder(rw_idx[i]).store(runway_holder(epoch, kTakeoffHolder, ps_idx[i]),
+                                                  std::memory_order_release);
+            reservations.push_back(ReservationExpiry {rw_idx[i], ps_idx[i], epoch, true});
+            tokens.emplace_back(AirportState::Proceed, rw_idx[i], ps_idx[i], expiration, epoch);
+        }
+        else {
+            if (Runway::state_of(store->runway_state(rw_idx[i])) == RunwayState::Available) {
+                rw_spare.push_back(rw_idx[i]);
+            }
+            tokens.emplace_back(AirportState::Hold);
+        }
+    }
+    free_runways.push_many(rw_spare);
+    if (!rw_spare.empty()) {
+        dispatch_waiters();
+    }
+    track_expiry(time, expiration, reservations.data(), reservations.size());
+    if (journal) {
+        journal_batch(*journal, JournalEvent::RequestTakeoffBatch, JournalEvent::RequestTakeoff,
+                      time, aircraft_ids, tokens);
+    }
+    return tokens;
+}
+
+std::vector<bool> Airport::perform_landing_batch(const std::vector<LandingRequestToken> &tokens) {
+    std::chrono::nanoseconds time = now();
+    std::vector<bool> started(tokens.size(), false);
+    std::vector<Movement> movements;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const LandingRequestToken &token = tokens[i];
+        if (token.state == AirportState::Proceed &&
+            start_batched(token.runway, token.parking_stand, token.expiration, token.epoch, time)) {
+            movements.push_back(Movement {token.runway, token.parking_stand});
+            started[i] = true;
+        }
+    }
+    if (!movements.empty()) {
+        run_after(operation_duration, [this, movements] () {
+            complete_landings(movements);
+        });
+    }
+    if (journal) {
+        journal_batch(*journal, JournalEvent::PerformLandingBatch, JournalEvent::PerformLanding, time, tokens,
+                      started);
+    }
+    return started;
+}
+
+std::vector<bool> Airport::perform_takeoff_batch(const std::vector<TakeOffRequestToken> &tokens) {
+    std::chrono::nanoseconds time = now();
+    std::vector<bool> started(tokens.size(), false);
+    std::vector<Movement> movements;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const TakeOffRequestToken &token = tokens[i];
+        if (token.state == AirportState::Proceed &&
+            start_batched(token.runway, token.parking_stand, token.expiration, token.epoch, time)) {
+            movements.push_back(Movement {token.runway, token.parking_stand});
+            started[i] = true;
+        }
+    }
+    if (!movements.empty()) {
+        run_after(operation_duration, [this, movements] () {
+            complete_takeoffs(movements);
+        });
+    }
+    if (journal) {
+        journal_batch(*journal, JournalEvent::PerformTakeoffBatch, JournalEvent::PerformTakeoff, time, tokens,
+                      started);
+    }
+    return started;
+}
+
+/*
+ * Called wherever resources go back into the free indexes. Only one thread grants at a time;
+ * a release that happens meanwhile just asks it for another pass, so no wake-up is lost.
+ */
+void Airport::dispatch_waiters() {
+    if (waiting.load() == 0 || in_dispatch) {
+        return;
+    }
+    dispatch_requested = true;
+    while (!dispatching.exchange(true)) {
+        while (dispatch_requested.exchange(false)) {
+            grant_waiters();
+        }
+        dispatching = false;
+        if (!dispatch_requested.load()) {
+            break;
+        }
+    }
+}
+
+/*
+ * Moves every waiter that arrived since the last call to the back of its queue, in arrival
+ * order. Only the dispatching thread calls it, and ~Airport, once nobody else can.
+ */
+void Airport::take_arrivals() {
+    Arrival<TakeOffWaiter> *takeoff = takeoff_arrivals.exchange(nullptr);
+    Arrival<TakeOffWaiter> *takeoffs = nullptr;
+    while (takeoff) {                   // newest first, turned around
+        Arrival<TakeOffWaiter> *next = takeoff->next;
+        takeoff->next = takeoffs;
+        takeoffs = takeoff;
+        takeoff = next;
+    }
+    while (takeoffs) {
+        Arrival<TakeOffWaiter> *next = takeoffs->next;
+        takeoff_waiters.push_back(std::move(takeoffs->waiter));
+        delete takeoffs;
+        takeoffs = next;
+    }
+    Arrival<LandingWaiter> *landing = landing_arrivals.exchange(nullptr);
+    Arrival<LandingWaiter> *landings = nullptr;
+    while (landing) {
+        Arrival<LandingWaiter> *next = landing->next;
+        landing->next = landings;
+        landings = landing;
+        landing = next;
+    }
+    while (landings) {
+        Arrival<LandingWaiter> *next = landings->next;
+        landing_waiters[landings->queue].push_back(std::move(landings->waiter));
+        delete landings;
+        landings = next;
+    }
+}
+
+/*
+ * Grants tokens from the heads of both queues until the head cannot be served. Takeoffs go
+ * first since they hand stands back to landings. The queues are only touched here, on the one
+ * dispatching thread, so they need no lock. Callbacks run once the counts are settled.
+ */
+void Airport::grant_waiters() {
+    std::vector<std::pair<std::function<void(TakeOffRequestToken)>, TakeOffRequestToken>> takeoffs;
+    std::vector<std::pair<std::function<void(LandingRequestToken)>, LandingRequestToken>> landings;
+    {
+        DispatchScope dispatch;
+        take_arrivals();
+        while (!takeoff_waiters.empty()) {
+            TakeOffRequestToken token(AirportState::Hold);
+            try {
+                token = reserve_takeoff(takeoff_waiters.front().aircraft_id);
+                if (token.state == AirportState::Hold) {
+                    break;
+                }
+            }
+            catch (std::runtime_error &) {
+                // the aircraft left meanwhile, it gets its Hold
+            }
+            collector.record(StatsOp::HoldWait, now() - takeoff_waiters.front().queued_at);
+            TRACE_INSTANT(Grant, token.runway, token.parking_stand, token.epoch);
+            if (journal) {
+                journal->append(journal_record(JournalEvent::Grant, now(), static_cast<uint8_t>(token.state),
+                                               kJournalTakeoff, token));
+            }
+            takeoffs.push_back(make_pair(std::move(takeoff_waiters.front().on_grant), token));
+            takeoff_waiters.pop_front();
+        }
+        takeoffs_waiting -= takeoffs.size();
+        // Strict priority: a class is only served once every higher class is empty.
+        for (int p = kLandingPriorities - 1; p >= 0; --p) {
+            std::deque<LandingWaiter> &queue = landing_waiters[p];
+            LandingPriority priority = static_cast<LandingPriority>(p);
+            size_t granted = 0;
+            while (!queue.empty()) {
+                LandingRequestToken token = reserve_landing(queue.front().aircraft_id, priority);
+                if (token.state == AirportState::Hold) {
+                    break;
+                }
+                record_grant(priority, queue.front().queued_at);
+                collector.record(StatsOp::HoldWait, now() - queue.front().queued_at);
+                TRACE_INSTANT(Grant, token.runway, token.parking_stand, token.epoch);
+                if (journal) {
+                    journal->append(journal_record(JournalEvent::Grant, now(), static_cast<uint8_t>(token.state),
+                                                   static_cast<uint8_t>(priority), token));
+                }
+                landings.push_back(make_pair(std::move(queue.front().on_grant), token));
+                queue.pop_front();
+                ++granted;
+            }
+            landings_waiting[p] -= granted;
+            if (!queue.empty()) {
+                break;
+            }
+        }
+        waiting -= takeoffs.size() + landings.size();
+    }
+    for (auto &granted : takeoffs) {
+        granted.first(granted.second);
+    }
+    for (auto &granted : landings) {
+        granted.first(granted.second);
+    }
+}
+
+/*
+ * A waiter is journaled before it is handed to the dispatcher, so its grant comes after its
+ * request in the journal. Requests take no lock: one that finds its class and every higher one
+ * empty reserves right away, anything else is pushed for the dispatcher to queue.
+ * @param aircraft_id: unique id of aircraft
+ * @param on_grant: receives the Proceed token
+ */
+void Airport::request_landing_async(const std::string &aircraft_id,
+                                    std::function<void(LandingRequestToken)> on_grant, LandingPriority priority) {
+    std::chrono::nanoseconds queued_at = now();
+    LandingRequestToken token(AirportState::Hold);
+    if (!landing_queued(priority)) {
+        token = reserve_landing(aircraft_id, priority);     // nobody to overtake
+    }
+    if (token.state == AirportState::Proceed) {
+        record_grant(priority, queued_at);
+    }
+    if (journal) {
+        // Before on_grant runs, so a perform it makes comes after the request.
+        journal->append(journal_record(JournalEvent::RequestLandingAsync, queued_at,
+                                       static_cast<uint8_t>(token.state), static_cast<uint8_t>(priority), token),
+                        aircraft_id);
+    }
+    if (token.state == AirportState::Proceed) {
+        on_grant(token);
+        return;
+    }
+    int queue = static_cast<int>(priority);
+    Arrival<LandingWaiter> *arrival = new Arrival<LandingWaiter> {
+            nullptr, queue, LandingWaiter {aircraft_id, std::move(on_grant), queued_at}};
+    arrival->next = landing_arrivals.load();
+    while (!landing_arrivals.compare_exchange_weak(arrival->next, arrival)) {
+    }
+    ++landings_waiting[queue];
+    ++waiting;
+    dispatch_waiters();     // resources freed before the waiter was counted would go unnoticed
+}
+
+std::future<LandingRequestToken> Airport::request_landing_async(const std::string &aircraft_id,
+                                                                LandingPriority priority) {
+    std::shared_ptr<std::promise<LandingRequestToken>> promise = std::make_shared<std::promise<LandingRequestToken>>();
+    std::future<LandingRequestToken> granted = promise->get_future();
+    request_landing_async(aircraft_id, [promise] (LandingRequestToken token) { promise->set_value(token); },
+                          priority);
+    return granted;
+}
+
+/*
+ * @param aircraft_id: unique id of a parked aircraft
+ * @param on_grant: receives the Proceed token
+ */
+void Airport::request_takeoff_async(const std::string &aircraft_id,
+                                    std::function<void(TakeOffRequestToken)> on_grant) {
+    ResourceHandle ps_idx;
+    if (!parking_info.find(aircraft_id, ps_idx)) {
+        if (journal) {
+            journal->append(journal_record(JournalEvent::RequestTakeoffAsync, now(), kJournalRefused), aircraft_id);
+        }
+        throw std::runtime_error("This airport does not have this plane");
+    }
+    std::chrono::nanoseconds queued_at = now();
+    TakeOffRequestToken token(AirportState::Hold);
+    try {
+        if (takeoffs_waiting.load() == 0) {
+            token = reserve_takeoff(aircraft_id);
+        }
+    }
+    catch (std::runtime_error &) {
+        if (journal) {
+            journal->append(journal_record(JournalEvent::RequestTakeoffAsync, queued_at, kJournalRefused),
+                            aircraft_id);
+        }
+        throw;
+    }
+    if (journal) {
+        journal->append(journal_record(JournalEvent::RequestTakeoffAsync, queued_at,
+                                       static_cast<uint8_t>(token.state), 0, token), aircraft_id);
+    }
+    if (token.state == AirportState::Proceed) {
+        on_grant(token);
+        return;
+    }
+    Arrival<TakeOffWaiter> *arrival = new Arrival<TakeOffWaiter> {
+            nullptr, 0, TakeOffWaiter {aircraft_id, std::move(on_grant), queued_at}};
+    arrival->next = takeoff_arrivals.load();
+    while (!takeoff_arrivals.compare_exchange_weak(arrival->next, arrival)) {
+    }
+    ++takeoffs_waiting;
+    ++waiting;
+    dispatch_waiters();
+}
+
+std::future<TakeOffRequestToken> Airport::request_takeoff_async(const std::string &aircraft_id) {
+    std::shared_ptr<std::promise<TakeOffRequestToken>> promise = std::make_shared<std::promise<TakeOffRequestToken>>();
+    std::future<TakeOffRequestToken> granted = promise->get_future();
+    request_takeoff_async(aircraft_id, [promise] (TakeOffRequestToken token) { promise->set_value(token); });
+    return granted;
+}
+
+/*
+ * Last resort of an Emergency: takes over the runway and stand of a lower class's landing
+ * reservation that has not started yet. Scans every runway, but only when nothing is free.
+ * A reservation's holder word is published last, with release, after its aircraft and time;
+ * one whose holder word is not there yet is still being written and is left alone.
+ * @return : a token either Proceed or Hold
+ */
+LandingRequestToken Airport::preempt_landing(const std::string &aircraft_id, LandingPriority priority) {
+    if (priority != LandingPriority::Emergency) {
+        return LandingRequestToken(AirportState::Hold);
+    }
+    for (uint32_t rw_idx = 0; rw_idx < store->runway_count(); ++rw_idx) {
+        uint32_t word = store->runway_state(rw_idx).load();
+        uint64_t holder = store->runway_holder(rw_idx).load(std::memory_order_acquire);
+        uint32_t epoch = word >> 8;
+        uint8_t holder_class = static_cast<uint8_t>(holder >> 32);
+        if (Runway::state_of(word) != RunwayState::Reserved || (holder >> 40) != epoch ||
+            holder_class >= static_cast<uint8_t>(priority)) {
+            continue;
+        }
+        uint32_t new_epoch;
+        if (!Runway::preempt(store->runway_state(rw_idx), epoch, new_epoch)) {
+            continue;
+        }
+        uint32_t ps_idx = static_cast<uint32_t>(holder);      // stays Reserved, now for this aircraft
+        std::chrono::nanoseconds time = now();
+        std::chrono::nanoseconds expiration = time + token_validity;
+        store->set_runway_aircraft(rw_idx, aircraft_id);
+        store->runway_time(rw_idx) = expiration.count();
+        store->runway_holder(rw_idx).store(runway_holder(new_epoch, static_cast<uint8_t>(priority), ps_idx),
+                                           std::memory_order_release);
+        ++preempted;
+        TRACE_INSTANT(Preempt, rw_idx, ps_idx, new_epoch);
+        track_expiry(time, expiration, ReservationExpiry {rw_idx, ps_idx, new_epoch, false});
+        return LandingRequestToken(AirportState::Proceed, rw_idx, ps_idx, expiration, new_epoch);
+    }
+    return LandingRequestToken(AirportState::Hold);
+}
+
+/*
+ * @return : if anyone of the same or a higher class is waiting, queued or still arriving
+ */
+bool Airport::landing_queued(LandingPriority priority) const {
+    for (int p = static_cast<int>(priority); p < kLandingPriorities; ++p) {
+        if (landings_waiting[p].load() != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Airport::record_grant(LandingPriority priority, std::chrono::nanoseconds queued_at) {
+    GrantCounters &stats = landing_latencies[static_cast<int>(priority)];
+    int64_t latency = (now() - queued_at).count();
+    ++stats.grants;
+    stats.total_ns += latency;
+    int64_t max = stats.max_ns.load();
+    while (latency > max && !stats.max_ns.compare_exchange_weak(max, latency)) {
+    }
+}
+
+/*
+ * A stale token's runway may be held by someone else by now, who may be writing its aircraft.
+ * The id is copied under the runway's aircraft lock and only kept if the runway's epoch and
+ * holder word were the token's both before and after the copy.
+ */
+std::string Airport::aircraft_of(const LandingRequestToken &token) const {
+    if (token.state != AirportState::Proceed || token.runway >= store->runway_count()) {
+        return std::string();
+    }
+    auto held = [this, &token] () {
+        uint64_t holder = store->runway_holder(token.runway).load(std::memory_order_acquire);
+        uint32_t word = store->runway_state(token.runway).load();
+        return (word >> 8) == token.epoch && (holder >> 40) == token.epoch &&
+               Runway::state_of(word) != RunwayState::Available;
+    };
+    if (!held()) {
+        return std::string();
+    }
+    std::string aircraft_id = store->copy_runway_aircraft(token.runway);
+    return held() ? aircraft_id : std::string();
+}
+
+std::string Airport::aircraft_of(const TakeOffRequestToken &token) const {
+    return aircraft_of(LandingRequestToken(token.state, token.runway, token.parking_stand, token.expiration,
+                                           token.epoch));
+}
+
+/*
+ * The counters are read one by one, so a grant in progress may show in some but not others.
+ */
+GrantLatency Airport::landing_latency(LandingPriority priority) {
+    const GrantCounters &stats = landing_latencies[static_cast<int>(priority)];
+    GrantLatency latency;
+    latency.grants = stats.grants.load();
+    latency.total = std::chrono::nanoseconds(stats.total_ns.load());
+    latency.max = std::chrono::nanoseconds(stats.max_ns.load());
+    return latency;
+}
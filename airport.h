@@ -8,40 +8,277 @@
 #include <vector>
 #include <unordered_map>
 #include <string>
-#include <future>
+#include <atomic>
+#include <functional>
+#include <chrono>
 #include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <future>
 
 #include "runway.h"
 #include "parking_stand.h"
 #include "tokens.h"
+#include "free_index.h"
+#include "resource_store.h"
+#include "parking_registry.h"
+#include "scheduler.h"
+#include "timing_wheel.h"
+#include "stats.h"
+#include "journal.h"
+#include "layout.h"
 
 /** This can be used to initialize the airport simulation object operation duration parameter
  * with a value which is used by the testing code. */
 static constexpr const int kOperationDurationSec = 5;
 
+/** How long a Proceed token stays valid by default, see Airport::set_token_validity(). */
+static constexpr const int kTokenValiditySec = 4;
+
+/** Resolution of token expiry: lapsed reservations are reclaimed on the first tick after their
+ * token's expiration. */
+static constexpr std::chrono::milliseconds kExpiryTick {1};
+
+/** Time from an async landing request to its grant, per priority class. */
+struct GrantLatency {
+    uint64_t grants = 0;
+    std::chrono::nanoseconds total {0};
+    std::chrono::nanoseconds max {0};
+};
+
 /** Simulation of an airport. Tiny preview of the headaches that come with the real thing. */
 class Airport {
 private:
-    std::vector<std::shared_ptr<Runway>> runways;
-    std::vector<std::shared_ptr<ParkingStand>> parking_stands;
-    std::unordered_map<std::string, std::shared_ptr<Runway>> runway_map;
-    std::unordered_map<std::string, std::shared_ptr<ParkingStand>> parking_stand_map;
-    std::unordered_map<std::string, std::shared_ptr<ParkingStand>> parking_info;   // key: aircraft_id, value: ParkingStand ptr
-    std::vector<std::shared_future<void>> future_arr;
-    std::mutex future_lock;
-    std::mutex parking_info_lock;
-
-    bool reserve_landing_resource(std::shared_ptr<Runway> rw, std::shared_ptr<ParkingStand> ps);
-    bool reserve_takeoff_resource(std::shared_ptr<Runway> rw, std::shared_ptr<ParkingStand> ps);
+    /** An issued Proceed token, remembered so its reservation can be reclaimed when it lapses. */
+    struct ReservationExpiry {
+        uint32_t rw_idx;
+        uint32_t ps_idx;
+        uint32_t epoch;     // runway reservation epoch; a later reservation is left alone
+        bool takeoff;
+    };
+
+    /** A tracked reservation on its way to the wheel, see track_expiry(). */
+    struct ExpiryNode {
+        ExpiryNode *next;
+        uint64_t deadline;
+        ReservationExpiry reservation;
+    };
+
+    /** Reservations one shard tracked since the last tick, newest first. */
+    struct ExpiryStaging {
+        std::atomic<ExpiryNode *> head {nullptr};
+        char pad[64 - sizeof(std::atomic<ExpiryNode *>)];      // keep the head on its own cache line
+    };
+
+    /** One landing or takeoff of a batch, completed together with the rest of its wave. The
+     * aircraft is the runway's, see ResourceStore::runway_aircraft(). */
+    struct Movement {
+        uint32_t rw_idx;
+        uint32_t ps_idx;
+    };
+
+    /** A client queued on Hold, granted a token in FIFO order once resources free up. */
+    struct LandingWaiter {
+        std::string aircraft_id;
+        std::function<void(LandingRequestToken)> on_grant;
+        std::chrono::nanoseconds queued_at;
+    };
+
+    struct TakeOffWaiter {
+        std::string aircraft_id;
+        std::function<void(TakeOffRequestToken)> on_grant;
+        std::chrono::nanoseconds queued_at;
+    };
+
+    /** A waiter on its way to its queue: pushed lock-free by the async request, moved over by
+     * the dispatcher, see take_arrivals(). */
+    template<typename Waiter>
+    struct Arrival {
+        Arrival *next;
+        int queue;          // landing priority class, 0 for takeoffs
+        Waiter waiter;
+    };
+
+    /** GrantLatency as counters, so a grant records itself without a lock. */
+    struct GrantCounters {
+        std::atomic<uint64_t> grants {0};
+        std::atomic<int64_t> total_ns {0};
+        std::atomic<int64_t> max_ns {0};
+    };
+
+    /** Lets scheduled expiry ticks find out whether the airport is still alive. */
+    struct Lifeline {
+        std::mutex l_lock;
+        Airport *airport;
+    };
+
+    std::shared_ptr<ResourceStore> store;                       // hot state, indexed by handle
+    std::vector<std::shared_ptr<Runway>> runways;               // views handed out by runway()
+    std::vector<std::shared_ptr<ParkingStand>> parking_stands;  // views handed out by parking_stand()
+    mutable std::unordered_map<std::string, ResourceHandle> runway_map;         // API edge only
+    mutable std::unordered_map<std::string, ResourceHandle> parking_stand_map;  // API edge only
+    mutable std::mutex ids_lock;
+    mutable std::atomic<bool> ids_pending {false};  // restore() leaves the maps to the first lookup
+    ParkingRegistry parking_info;
+    ShardedFreeIndex free_runways;
+    ShardedFreeIndex free_parking_stands;
+    std::atomic<size_t> in_flight {0};     // operations scheduled but not completed yet
+    std::mutex idle_lock;
+    std::condition_variable idle_cv;
+    std::shared_ptr<Scheduler> scheduler;
+    std::chrono::nanoseconds operation_duration {std::chrono::seconds(kOperationDurationSec)};
+    std::chrono::nanoseconds token_validity {std::chrono::seconds(kTokenValiditySec)};
+    bool log_movements = false;
+    TimingWheel<ReservationExpiry> expiry_wheel;    // ticks are kExpiryTick; only ticks touch it
+    std::mutex expiry_lock;                         // guards the wheel against overlapping ticks
+    std::vector<std::unique_ptr<ExpiryStaging>> expiry_staging;    // one per shard
+    std::atomic<uint64_t> next_expiry_tick;         // earliest expiry tick scheduled, if any
+    std::shared_ptr<Lifeline> lifeline;
+    std::deque<LandingWaiter> landing_waiters[kLandingPriorities];     // FIFO per priority class
+    std::deque<TakeOffWaiter> takeoff_waiters;      // the queues are the dispatching thread's
+    std::atomic<Arrival<LandingWaiter> *> landing_arrivals {nullptr};  // not queued yet, newest first
+    std::atomic<Arrival<TakeOffWaiter> *> takeoff_arrivals {nullptr};
+    std::atomic<size_t> landings_waiting[kLandingPriorities] {};      // per class, arrivals included
+    std::atomic<size_t> takeoffs_waiting {0};
+    std::atomic<size_t> waiting {0};                // waiters in both queues
+    std::atomic<bool> dispatching {false};          // one thread grants at a time
+    std::atomic<bool> dispatch_requested {false};   // resources freed while it was granting
+    GrantCounters landing_latencies[kLandingPriorities];
+    std::atomic<uint64_t> preempted {0};
+    StatsCollector collector;
+    std::shared_ptr<Journal> journal;               // null unless set_journal()
+
+    bool reserve_landing_resource(ResourceHandle rw_idx, ResourceHandle ps_idx, uint32_t &epoch);
+    bool reserve_takeoff_resource(ResourceHandle rw_idx, ResourceHandle ps_idx, uint32_t &epoch);
+    void release_runway(uint32_t rw_idx);
+    void release_parking_stand(uint32_t ps_idx);
+    std::chrono::nanoseconds now();
+    void run_after(std::chrono::nanoseconds delay, std::function<void()> fn);
+    void operation_done();
+    LandingRequestToken reserve_landing(const std::string &aircraft_id, LandingPriority priority);
+    TakeOffRequestToken reserve_takeoff(const std::string &aircraft_id);
+    bool start_landing(const LandingRequestToken &token);
+    bool start_takeoff(const TakeOffRequestToken &token);
+    void complete_landing(uint32_t rw_idx, uint32_t ps_idx);
+    void complete_takeoff(uint32_t rw_idx, uint32_t ps_idx);
+    void complete_landings(const std::vector<Movement> &movements);
+    void complete_takeoffs(const std::vector<Movement> &movements);
+    bool start_batched(ResourceHandle rw_idx, ResourceHandle ps_idx, std::chrono::nanoseconds expiration,
+                       uint32_t epoch, std::chrono::nanoseconds time);
+    LandingRequestToken preempt_landing(const std::string &aircraft_id, LandingPriority priority);
+    bool landing_queued(LandingPriority priority) const;
+    void record_grant(LandingPriority priority, std::chrono::nanoseconds queued_at);
+    void track_expiry(std::chrono::nanoseconds time, std::chrono::nanoseconds expiration,
+                      const ReservationExpiry &reservation);
+    void track_expiry(std::chrono::nanoseconds time, std::chrono::nanoseconds expiration,
+                      const ReservationExpiry *reservations, size_t count);
+    void schedule_expiry_tick(uint64_t tick, std::chrono::nanoseconds time);
+    void dispatch_waiters();
+    void take_arrivals();
+    void grant_waiters();
+    void expire_tokens(uint64_t scheduled_tick);
+    void index_ids() const;
 
 public:
+    /** Runs the airport on the wall clock with its own TimerService. */
+    Airport();
+    /** Runs the airport on scheduler's clock, e.g. a SimEngine for virtual time.
+     * Operations still pending on the scheduler must run before the airport is destroyed. */
+    explicit Airport(std::shared_ptr<Scheduler> scheduler);
+    /** Waits for every operation in flight, see wait_idle(). */
     ~Airport();
+    /** How long a landing or takeoff keeps its runway, kOperationDurationSec by default.
+     * Not thread-safe, like adding resources. */
+    void set_operation_duration(std::chrono::nanoseconds duration) { operation_duration = duration; }
+    /** How long tokens issued from now on stay valid, kTokenValiditySec by default.
+     * Not thread-safe, like adding resources. */
+    void set_token_validity(std::chrono::nanoseconds validity) { token_validity = validity; }
+    /** Logs a line for every completed landing and takeoff through the asynchronous Logger.
+     * Off by default. Not thread-safe, like adding resources. */
+    void set_movement_log(bool on) { log_movements = on; }
+    /** Appends every client call and its outcome, every grant, completion and expiry to journal,
+     * from now on; null stops it. Take a snapshot() right before, so a replay can start from
+     * the same state, see replay_journal(). Not thread-safe, like adding resources. */
+    void set_journal(std::shared_ptr<Journal> journal) { this->journal = journal; }
+    /** Splits the free runways and stands into count shards, e.g. one per core or terminal.
+     * A request takes from its thread's shard first, and the stand from its runway's shard,
+     * and only steals from the other shards once those are empty. Its token's expiry is staged
+     * on the same shard. One shard by default; must be called before any resource is added. */
+    void set_shards(unsigned count);
+    unsigned shards() const { return free_runways.shard_count(); }
+    /** Resources are dealt out over the shards in turn, or go to the given shard. */
     void add_runway(std::shared_ptr<Runway> runway);
+    void add_runway(std::shared_ptr<Runway> runway, unsigned shard);
     void add_parking_stands(std::shared_ptr<ParkingStand> parking_stand);
-    LandingRequestToken request_landing(std::string aircraft_id);
+    void add_parking_stands(std::shared_ptr<ParkingStand> parking_stand, unsigned shard);
+    /** Adds every resource of layout, in order, as the add_* calls would, but sizes every
+     * container once, builds the Runway and ParkingStand objects in one block per kind and
+     * indexes the ids on the first lookup. Throws before adding anything if a shard is out of
+     * range. Not thread-safe, like adding resources. */
+    void load_layout(const Layout &layout);
+    /** Reads the layout file at path, see layout.h, and loads it. */
+    void load_layout(const std::string &path) { load_layout(read_layout(path)); }
+    /** An Emergency that finds nothing free takes over a lower class's landing reservation that
+     * is still Reserved. The preempted token's perform then fails with "Runway is not reserved". */
+    LandingRequestToken request_landing(std::string aircraft_id, LandingPriority priority = LandingPriority::Routine);
     TakeOffRequestToken request_takeoff(std::string aircraft_id);
     bool perform_landing(LandingRequestToken token);
     bool perform_takeoff(TakeOffRequestToken token);
+    /** Batch versions for a whole wave of aircraft: one pass over the free indexes, one clock
+     * read and one completion event per call. Tokens come back in the order of the ids. */
+    std::vector<LandingRequestToken> request_landing_batch(const std::vector<std::string> &aircraft_ids);
+    std::vector<TakeOffRequestToken> request_takeoff_batch(const std::vector<std::string> &aircraft_ids);
+    /** A token that cannot be performed (Hold, expired, not reserved) yields false instead of
+     * throwing, so one stale token does not hold up the rest of the wave. */
+    std::vector<bool> perform_landing_batch(const std::vector<LandingRequestToken> &tokens);
+    std::vector<bool> perform_takeoff_batch(const std::vector<TakeOffRequestToken> &tokens);
+    /** FIFO alternative to retrying on Hold: on_grant gets a Proceed token as soon as a runway
+     * and stand free up, ahead of every later waiter. It runs inline if the resources are free
+     * now, otherwise on the thread that freed them, so it should be short, must not throw and
+     * must not destroy the airport.
+     * Waiters still queued when the airport is destroyed are dropped. Higher priority classes
+     * are served first; within a class, in arrival order. */
+    void request_landing_async(const std::string &aircraft_id, std::function<void(LandingRequestToken)> on_grant,
+                               LandingPriority priority = LandingPriority::Routine);
+    std::future<LandingRequestToken> request_landing_async(const std::string &aircraft_id,
+                                                           LandingPriority priority = LandingPriority::Routine);
+    /** Throws like request_takeoff if the aircraft is not parked here. A waiter whose aircraft
+     * has left by the time a runway frees up is granted a Hold token. */
+    void request_takeoff_async(const std::string &aircraft_id, std::function<void(TakeOffRequestToken)> on_grant);
+    std::future<TakeOffRequestToken> request_takeoff_async(const std::string &aircraft_id);
+    /** The aircraft a Proceed token was issued for, while its reservation stands; empty once
+     * the token is stale. Only for the holder of the token, before it performs it. */
+    std::string aircraft_of(const LandingRequestToken &token) const;
+    std::string aircraft_of(const TakeOffRequestToken &token) const;
+    size_t waiters() const { return waiting.load(); }
+    GrantLatency landing_latency(LandingPriority priority);
+    uint64_t preemptions() const { return preempted.load(); }
+    /** Latency histograms of the request and perform calls and of the wait-queue hold, plus
+     * failed reservations per resource, merged from every thread. */
+    AirportStats stats() const { return collector.snapshot(); }
+    /** Call timing is on by default; hold waits and failure counters are always kept. */
+    void set_call_timing(bool on) { collector.set_timing(on); }
+    /** Writes the whole airport to path: resources, reservations and their epochs, parked
+     * aircraft and operations in progress, see snapshot.h. Throws if clients are waiting in the
+     * queues, since their callbacks cannot be written, or if the file cannot be written. Take
+     * it while nothing else uses the airport, e.g. from a SimEngine event. Stats are left out. */
+    void snapshot(const std::string &path);
+    /** Loads a snapshot into an airport that has no resources yet. It carries on on its own
+     * clock where the snapshot left off: reservations lapse and operations complete after the
+     * time they had left, and tokens issued before the snapshot can still be performed. The
+     * airport keeps its own shard count. */
+    void restore(const std::string &path);
+    /** Blocks until no landing or takeoff is in flight. On a SimEngine the engine has to be
+     * run by someone else meanwhile. */
+    void wait_idle();
+
+    /** String id -> handle, kInvalidHandle if the airport has no such resource. The first
+     * lookup after restore() indexes the ids. */
+    ResourceHandle find_runway(const std::string &runway_id) const;
+    ResourceHandle find_parking_stand(const std::string &parking_id) const;
+    std::shared_ptr<Runway> runway(ResourceHandle handle) const { return runways.at(handle); }
+    std::shared_ptr<ParkingStand> parking_stand(ResourceHandle handle) const { return parking_stands.at(handle); }
+    size_t operations_in_flight() const { return in_flight.load(); }
 };
 
 #endif //AIRPORTSIMULATOR_AIRPORT_H
@@ -0,0 +1,704 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <cstdlib>
+
+#include "airport.h"
+#include "sim_engine.h"
+#include "parking_registry.h"
+#include "trace.h"
+#include "logger.h"
+#include "timer_service.h"
+#include "cached_clock.h"
+#include "journal.h"
+#include "random.h"
+#include "layout.h"
+#include "replay.h"
+
+using namespace std;
+using namespace std::chrono;
+
+/**
+ * Request latency against the number of parking stands. Runs without any sleeps,
+ * so the numbers only show the cost of the request path itself.
+ */
+
+static const int kRunways = 3;
+
+/** Average ns per request_landing on an airport whose runways are all reserved. */
+static double bench_hold(int num_ps, int iterations) {
+    Airport airport {};
+    for (int i = 0; i < kRunways; ++i) {
+        airport.add_runway(make_shared<Runway>(i));
+    }
+    for (int i = 0; i < num_ps; ++i) {
+        airport.add_parking_stands(make_shared<ParkingStand>(i));
+    }
+    for (int i = 0; i < kRunways; ++i) {
+        airport.request_landing("Reserved " + to_string(i));
+    }
+    string id {"Aircraft"};
+    int held = 0;
+    auto start = steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        held += airport.request_landing(id).state == AirportState::Hold;
+    }
+    duration<double, nano> elapsed = steady_clock::now() - start;
+    if (held != iterations) {
+        cerr << "unexpected Proceed on a full airport\n";
+    }
+    return elapsed.count() / iterations;
+}
+
+/** Average ns per granted request_landing until every stand is reserved. */
+static double bench_grant(int num_ps) {
+    Airport airport {};
+    for (int i = 0; i < num_ps; ++i) {
+        airport.add_runway(make_shared<Runway>(i));
+        airport.add_parking_stands(make_shared<ParkingStand>(i));
+    }
+    string id {"Aircraft"};
+    int granted = 0;
+    auto start = steady_clock::now();
+    for (int i = 0; i < num_ps; ++i) {
+        granted += airport.request_landing(id).state == AirportState::Proceed;
+    }
+    duration<double, nano> elapsed = steady_clock::now() - start;
+    if (granted != num_ps) {
+        cerr << "unexpected Hold on an empty airport\n";
+    }
+    return elapsed.count() / num_ps;
+}
+
+/**
+ * Reservation contention: the old mutex path (std::try_lock on the runway and stand locks,
+ * state checked under the locks) against the CAS path used by reserve_landing_resource.
+ * Every thread reserves a pair and releases it again, over a shared pool of pairs. The last
+ * column runs the same pool through the whole request_landing/request_takeoff path, so a lock
+ * anywhere on it shows up too.
+ */
+
+static const int kContentionPairs = 8;
+
+struct LockedRunway {
+    std::mutex r_lock;
+    RunwayState state = RunwayState::Available;
+};
+
+struct LockedParkingStand {
+    std::mutex p_lock;
+    ParkingStandState state = ParkingStandState::Available;
+};
+
+static bool mutex_reserve(LockedRunway &rw, LockedParkingStand &ps) {
+    if (std::try_lock(rw.r_lock, ps.p_lock) != -1) {
+        return false;
+    }
+    bool ok = rw.state == RunwayState::Available && ps.state == ParkingStandState::Available;
+    if (ok) {
+        rw.state = RunwayState::Reserved;
+        ps.state = ParkingStandState::Reserved;
+    }
+    rw.r_lock.unlock();
+    ps.p_lock.unlock();
+    return ok;
+}
+
+static void mutex_release(LockedRunway &rw, LockedParkingStand &ps) {
+    std::lock(rw.r_lock, ps.p_lock);
+    rw.state = RunwayState::Available;
+    ps.state = ParkingStandState::Available;
+    rw.r_lock.unlock();
+    ps.p_lock.unlock();
+}
+
+static bool cas_reserve(Runway &rw, ParkingStand &ps) {
+    if (!rw.transition(RunwayState::Available, RunwayState::Reserved)) {
+        return false;
+    }
+    if (!ps.transition(ParkingStandState::Available, ParkingStandState::Reserved)) {
+        rw.setState(RunwayState::Available);
+        return false;
+    }
+    return true;
+}
+
+static void cas_release(Runway &rw, ParkingStand &ps) {
+    ps.setState(ParkingStandState::Available);
+    rw.setState(RunwayState::Available);
+}
+
+/** Million successful reserve+release cycles per second over all threads. */
+template<typename Rw, typename Ps, typename Reserve, typename Release>
+static double bench_contention(int threads, int cycles, Reserve reserve, Release release) {
+    vector<Rw> rws(kContentionPairs);
+    vector<Ps> pss(kContentionPairs);
+    vector<thread> workers;
+    atomic<bool> go {false};
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            while (!go) {
+                this_thread::yield();
+            }
+            int done = 0;
+            for (unsigned i = t; done < cycles; ++i) {
+                Rw &rw = rws[i % kContentionPairs];
+                Ps &ps = pss[(i / kContentionPairs) % kContentionPairs];
+                if (reserve(rw, ps)) {
+                    release(rw, ps);
+                    ++done;
+                }
+            }
+        });
+    }
+    auto start = steady_clock::now();
+    go = true;
+    for (auto &w : workers) {
+        w.join();
+    }
+    duration<double> elapsed = steady_clock::now() - start;
+    return threads * static_cast<double>(cycles) / elapsed.count() / 1e6;
+}
+
+/** Runs zero-delay work (completions) inline and hands anything later (expiry ticks) to a timer. */
+class InlineScheduler : public Scheduler {
+private:
+    TimerService timer;
+
+public:
+    InlineScheduler() : timer(1) {}
+
+    nanoseconds now() override {
+        return timer.now();
+    }
+
+    void schedule_after(nanoseconds delay, function<void()> fn) override {
+        if (delay <= nanoseconds::zero()) {
+            fn();
+            return;
+        }
+        timer.schedule_after(delay, fn);
+    }
+};
+
+/** Million land + take-off cycles per second over all threads, through request_* and perform_*
+ * on an airport whose operations complete inside perform_*. Hold answers are retried. */
+static double bench_request_contention(int threads, int cycles) {
+    Airport airport {make_shared<InlineScheduler>()};
+    airport.set_operation_duration(nanoseconds::zero());
+    for (int i = 0; i < kContentionPairs; ++i) {
+        airport.add_runway(make_shared<Runway>(i));
+        airport.add_parking_stands(make_shared<ParkingStand>(i));
+    }
+    vector<thread> workers;
+    atomic<bool> go {false};
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            string id = "Aircraft " + to_string(t);
+            while (!go) {
+                this_thread::yield();
+            }
+            for (int done = 0; done < cycles; ++done) {
+                LandingRequestToken landing;
+                while ((landing = airport.request_landing(id)).state != AirportState::Proceed) {
+                    this_thread::yield();
+                }
+                airport.perform_landing(landing);
+                TakeOffRequestToken takeoff;
+                while ((takeoff = airport.request_takeoff(id)).state != AirportState::Proceed) {
+                    this_thread::yield();
+                }
+                airport.perform_takeoff(takeoff);
+            }
+        });
+    }
+    auto start = steady_clock::now();
+    go = true;
+    for (auto &w : workers) {
+        w.join();
+    }
+    duration<double> elapsed = steady_clock::now() - start;
+    return threads * static_cast<double>(cycles) / elapsed.count() / 1e6;
+}
+
+/**
+ * Virtual-time throughput: aircraft cycle land -> turnaround -> take off -> cruise on a
+ * SimEngine, and we count movements per second of wall time.
+ */
+struct SimTraffic {
+    shared_ptr<SimEngine> engine;
+    Airport airport;
+    vector<string> ids;
+    long movements;
+    long target;
+
+    SimTraffic(int num_rw, int num_ps, int num_aircraft, long target) :
+            engine(make_shared<SimEngine>()), airport(engine), movements(0), target(target) {
+        for (int i = 0; i < num_rw; ++i) {
+            airport.add_runway(make_shared<Runway>(i));
+        }
+        for (int i = 0; i < num_ps; ++i) {
+            airport.add_parking_stands(make_shared<ParkingStand>(i));
+        }
+        for (int i = 0; i < num_aircraft; ++i) {
+            ids.push_back("Aircraft " + to_string(i));
+            engine->schedule_after(milliseconds(i), [this, i]() { arrive(i); });
+        }
+    }
+
+    void arrive(int i) {
+        LandingRequestToken token = airport.request_landing(ids[i]);
+        if (token.state == AirportState::Hold) {
+            engine->schedule_after(seconds(1), [this, i]() { arrive(i); });
+            return;
+        }
+        airport.perform_landing(token);
+        if (++movements < target) {
+            engine->schedule_after(seconds(kOperationDurationSec + 60), [this, i]() { depart(i); });
+        }
+    }
+
+    void depart(int i) {
+        TakeOffRequestToken token = airport.request_takeoff(ids[i]);
+        if (token.state == AirportState::Hold) {
+            engine->schedule_after(seconds(1), [this, i]() { depart(i); });
+            return;
+        }
+        airport.perform_takeoff(token);
+        if (++movements < target) {
+            engine->schedule_after(seconds(kOperationDurationSec + 60), [this, i]() { arrive(i); });
+        }
+    }
+};
+
+/**
+ * Full land + take-off waves over an airport with `resources` runways and stands each,
+ * in virtual time, one call per aircraft or one batch call per wave. Returns million movements per wall second.
+ */
+static double bench_waves(int resources, int waves, bool batched) {
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    Airport airport {engine};
+    for (int i = 0; i < resources; ++i) {
+        airport.add_runway(make_shared<Runway>(i));
+        airport.add_parking_stands(make_shared<ParkingStand>(i));
+    }
+    vector<string> ids;
+    for (int i = 0; i < resources; ++i) {
+        ids.push_back("Aircraft " + to_string(i));
+    }
+    long movements = 0;
+    auto start = steady_clock::now();
+    for (int w = 0; w < waves; ++w) {
+        if (batched) {
+            for (bool started : airport.perform_landing_batch(airport.request_landing_batch(ids))) {
+                movements += started;
+            }
+            engine->run();
+            for (bool started : airport.perform_takeoff_batch(airport.request_takeoff_batch(ids))) {
+                movements += started;
+            }
+            engine->run();
+            continue;
+        }
+        for (auto &id : ids) {
+            movements += airport.perform_landing(airport.request_landing(id));
+        }
+        engine->run();
+        for (auto &id : ids) {
+            movements += airport.perform_takeoff(airport.request_takeoff(id));
+        }
+        engine->run();
+    }
+    duration<double> elapsed = steady_clock::now() - start;
+    return movements / elapsed.count() / 1e6;
+}
+
+/** The old parking_info: one map behind one mutex. */
+struct SingleLockRegistry {
+    std::mutex lock;
+    std::unordered_map<string, ResourceHandle> stands;
+
+    void insert(const string &id, ResourceHandle ps) {
+        lock_guard<std::mutex> guard(lock);
+        stands[id] = ps;
+    }
+    bool find(const string &id, ResourceHandle &ps) {
+        lock_guard<std::mutex> guard(lock);
+        auto got = stands.find(id);
+        if (got == stands.end()) {
+            return false;
+        }
+        ps = got->second;
+        return true;
+    }
+};
+
+/** Million takeoff-style lookups per second over all threads, 10k parked aircraft. */
+template<typename Registry>
+static double bench_registry(int threads, int lookups) {
+    Registry registry;
+    vector<string> ids;
+    for (int i = 0; i < 10000; ++i) {
+        ids.push_back("Aircraft " + to_string(i));
+        registry.insert(ids.back(), i);
+    }
+    vector<thread> workers;
+    auto start = steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            ResourceHandle ps;
+            for (int i = 0; i < lookups; ++i) {
+                registry.find(ids[(static_cast<size_t>(i) * 7919 + t) % ids.size()], ps);
+            }
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+    duration<double> elapsed = steady_clock::now() - start;
+    return threads * static_cast<double>(lookups) / elapsed.count() / 1e6;
+}
+
+/**
+ * Saturated arrivals through the priority wait queue: an arrival every 0.9 s against 4 runways
+ * that land 0.8 aircraft per second, every 20th an Emergency and every 5th a Priority.
+ * Prints how long each class waits for its grant in virtual time.
+ */
+static void bench_priority(int arrivals) {
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    Airport airport {engine};
+    for (int i = 0; i < 4; ++i) {
+        airport.add_runway(make_shared<Runway>(i));
+    }
+    for (int i = 0; i < arrivals; ++i) {
+        airport.add_parking_stands(make_shared<ParkingStand>(i));
+    }
+    for (int i = 0; i < arrivals; ++i) {
+        LandingPriority priority = i % 20 == 0 ? LandingPriority::Emergency :
+                                   i % 5 == 0 ? LandingPriority::Priority : LandingPriority::Routine;
+        engine->schedule_after(milliseconds(900 * i), [&airport, i, priority]() {
+            airport.request_landing_async("Aircraft " + to_string(i), [&airport](LandingRequestToken token) {
+                airport.perform_landing(token);
+            }, priority);
+        });
+    }
+    engine->run();
+    const char *names[] = {"routine", "priority", "emergency"};
+    cout << '\n' << setw(10) << "class" << setw(10) << "grants" << setw(12) << "mean s" << setw(12) << "max s" << '\n';
+    for (int p = 0; p < kLandingPriorities; ++p) {
+        GrantLatency latency = airport.landing_latency(static_cast<LandingPriority>(p));
+        double mean = latency.grants ? duration<double>(latency.total).count() / latency.grants : 0;
+        cout << setw(10) << names[p] << setw(10) << latency.grants << setprecision(2) << setw(12) << mean
+             << setw(12) << duration<double>(latency.max).count() << '\n';
+    }
+}
+
+/** Average ns per StatsCollector::record, the part of call timing that is not the clock. */
+static double bench_stats_record(int iterations) {
+    StatsCollector collector;
+    auto start = steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        collector.record(StatsOp::RequestLanding, nanoseconds(100 + (i & 1023)));
+    }
+    duration<double, nano> elapsed = steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+/** Cost of one now() on a scheduler, the clock read behind every token issue and check. */
+static double bench_clock(Scheduler &clock, int iterations) {
+    int64_t sink = 0;
+    auto start = steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        sink += clock.now().count();
+    }
+    duration<double, nano> elapsed = steady_clock::now() - start;
+    return (elapsed.count() + (sink == 42)) / iterations;
+}
+
+static double bench_trace_record(int iterations) {
+    auto start = steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        trace_record(TraceEvent::Reserve, TracePhase::Instant, i & 15, i & 1023, i);
+    }
+    duration<double, nano> elapsed = steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+/** Standing up an airport with add_* against restoring a snapshot of it, in milliseconds. */
+static void bench_snapshot(int num_rw, int num_ps) {
+    const string path = "/tmp/airport_bench_snapshot.bin";
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    auto start = steady_clock::now();
+    Airport airport {engine};
+    for (int i = 0; i < num_rw; ++i) {
+        airport.add_runway(make_shared<Runway>(i));
+    }
+    for (int i = 0; i < num_ps; ++i) {
+        airport.add_parking_stands(make_shared<ParkingStand>(i));
+    }
+    duration<double, milli> built = steady_clock::now() - start;
+    for (int i = 0; i < num_ps / 2; ++i) {     // half the stands taken, a few landings in flight
+        LandingRequestToken token = airport.request_landing("Aircraft " + to_string(i));
+        airport.perform_landing(token);
+        if (i % num_rw == num_rw - 1) {
+            engine->run();
+        }
+    }
+    start = steady_clock::now();
+    airport.snapshot(path);
+    duration<double, milli> written = steady_clock::now() - start;
+    shared_ptr<SimEngine> engine2 = make_shared<SimEngine>();
+    start = steady_clock::now();
+    Airport restored {engine2};
+    restored.restore(path);
+    duration<double, milli> loaded = steady_clock::now() - start;
+    start = steady_clock::now();
+    restored.find_parking_stand("p_0");
+    duration<double, milli> indexed = steady_clock::now() - start;
+    engine->run();
+    engine2->run();
+    remove(path.c_str());
+    cout << "\nsnapshot, " << num_ps << " stands: add_* " << setprecision(1) << built.count() << " ms, snapshot "
+         << written.count() << " ms, restore " << loaded.count() << " ms, first id lookup " << indexed.count()
+         << " ms\n";
+}
+
+/** One add_* call per resource against reading a layout file and loading it, in milliseconds. */
+static void bench_layout(int num_rw, int num_ps) {
+    const string path = "/tmp/airport_bench_layout.txt";
+    Layout layout;
+    for (int i = 0; i < num_rw; ++i) {
+        layout.runways.add("r_" + to_string(i));
+    }
+    for (int i = 0; i < num_ps; ++i) {
+        layout.parking_stands.add("p_" + to_string(i));
+    }
+    write_layout(path, layout);
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    duration<double, milli> added;
+    auto start = steady_clock::now();
+    {
+        Airport airport {engine};
+        for (int i = 0; i < num_rw; ++i) {
+            airport.add_runway(make_shared<Runway>(i));
+        }
+        for (int i = 0; i < num_ps; ++i) {
+            airport.add_parking_stands(make_shared<ParkingStand>(i));
+        }
+        added = steady_clock::now() - start;
+    }
+    start = steady_clock::now();
+    Layout read = read_layout(path);
+    duration<double, milli> parsed = steady_clock::now() - start;
+    start = steady_clock::now();
+    {
+        Airport airport {engine};
+        airport.load_layout(read);
+        duration<double, milli> loaded = steady_clock::now() - start;
+        start = steady_clock::now();
+        airport.find_parking_stand("p_0");
+        duration<double, milli> indexed = steady_clock::now() - start;
+        cout << "\nlayout, " << num_ps << " stands: add_* " << setprecision(1) << added.count() << " ms, read "
+             << parsed.count() << " ms, load_layout " << loaded.count() << " ms, first id lookup " << indexed.count()
+             << " ms\n";
+    }
+    remove(path.c_str());
+}
+
+/**
+ * Single-call land + take-off waves as in bench_waves(), without and with a journal, then the
+ * journal read back and replayed from the snapshot taken when it started.
+ */
+static void bench_journal(int resources, int waves) {
+    const string snapshot_path = "/tmp/airport_bench_journal.snapshot";
+    const string path = "/tmp/airport_bench_journal.bin";
+    vector<string> ids;
+    for (int i = 0; i < resources; ++i) {
+        ids.push_back("Aircraft " + to_string(i));
+    }
+    double rate[2];
+    uint64_t records = 0, bytes = 0;
+    for (bool journaled : {false, true}) {
+        shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+        Airport airport {engine};
+        for (int i = 0; i < resources; ++i) {
+            airport.add_runway(make_shared<Runway>(i));
+            airport.add_parking_stands(make_shared<ParkingStand>(i));
+        }
+        shared_ptr<Journal> journal;
+        if (journaled) {
+            airport.snapshot(snapshot_path);
+            journal = make_shared<Journal>(path);
+            airport.set_journal(journal);
+        }
+        long movements = 0;
+        auto start = steady_clock::now();
+        for (int w = 0; w < waves; ++w) {
+            for (auto &id : ids) {
+                movements += airport.perform_landing(airport.request_landing(id));
+            }
+            engine->run();
+            for (auto &id : ids) {
+                movements += airport.perform_takeoff(airport.request_takeoff(id));
+            }
+            engine->run();
+        }
+        duration<double> elapsed = steady_clock::now() - start;
+        rate[journaled] = movements / elapsed.count() / 1e6;
+        if (journal) {
+            journal->flush();
+            records = journal->records();
+            bytes = journal->bytes();
+        }
+    }
+    auto start = steady_clock::now();
+    vector<JournalEntry> entries = read_journal(path);
+    duration<double> read = steady_clock::now() - start;
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    Airport replayed {engine};
+    replayed.restore(snapshot_path);
+    ReplayStats stats = replay_journal(entries, replayed, *engine);
+    remove(snapshot_path.c_str());
+    remove(path.c_str());
+    cout << "\njournal, " << resources << " aircraft waves: " << setprecision(3) << rate[0] << " -> " << rate[1]
+         << " M movements/s journaled, " << setprecision(1) << double(bytes) / records << " bytes/record; read "
+         << setprecision(0) << records / read.count() << " records/s, replay " << stats.calls / stats.wall_sec
+         << " calls/s, " << stats.diverged << " diverged\n";
+}
+
+/*
+ * The draws are summed into the result, as in bench_clock(), so the optimiser must keep them.
+ * @return : nanoseconds per draw of draw
+ */
+template<typename Draw>
+static double bench_draw(long n, Draw draw) {
+    double sink = 0;
+    auto start = steady_clock::now();
+    for (long i = 0; i < n; ++i) {
+        sink += draw();
+    }
+    duration<double, nano> elapsed = steady_clock::now() - start;
+    return (elapsed.count() + (sink == 42)) / n;
+}
+
+/*
+ * @return : nanoseconds per sample of fill, a block of 4096 at a time
+ */
+template<typename Fill>
+static double bench_fill(long n, Fill fill) {
+    double sink = 0;
+    vector<double> block(4096);
+    auto start = steady_clock::now();
+    for (long done = 0; done < n; done += 4096) {
+        fill(block.data(), block.size());
+        sink += block[done & 4095];
+    }
+    duration<double, nano> elapsed = steady_clock::now() - start;
+    return (elapsed.count() + (sink == 42)) / n;
+}
+
+/** The C library and <random> against the seeded streams, scalar and in bulk, in ns/sample. */
+static void bench_random(long n) {
+    mt19937_64 mt(42);
+    Xoshiro256 rng(42, 0);
+    RandomBulk bulk(42, 0);
+    exponential_distribution<double> std_exponential(1.0);
+    cout << "\nrandom (ns/sample): rand() " << setprecision(2) << bench_draw(n, []() { return double(rand()); })
+         << ", mt19937_64 " << bench_draw(n, [&mt]() { return double(mt()); })
+         << ", xoshiro " << bench_draw(n, [&rng]() { return double(rng()); })
+         << ", thread_random " << bench_draw(n, []() { return double(thread_random()()); })
+         << ", bulk uniform " << bench_fill(n, [&bulk](double *out, size_t count) { bulk.fill_uniform(out, count); })
+         << '\n';
+    cout << "exponential: <random> " << bench_draw(n, [&mt, &std_exponential]() { return std_exponential(mt); })
+         << ", sampler " << bench_draw(n, [&rng]() { return exponential(rng, 1.0); })
+         << ", bulk " << bench_fill(n, [&bulk](double *out, size_t count) { bulk.fill_exponential(out, count, 1.0); })
+         << "; normal bulk " << bench_fill(n, [&bulk](double *out, size_t n) { bulk.fill_normal(out, n, 0, 1); })
+         << ", poisson(120) " << bench_draw(n / 10, [&rng]() { return double(poisson(rng, 120)); }) << '\n';
+}
+
+int main() {
+    const int sizes[] = {8, 64, 512, 4096, 32768, 100000};
+    cout << setw(10) << "stands" << setw(16) << "hold ns/op" << setw(16) << "grant ns/op" << '\n';
+    for (int num_ps : sizes) {
+        double hold = bench_hold(num_ps, 200000);
+        double grant = bench_grant(num_ps);
+        cout << setw(10) << num_ps << setw(16) << fixed << setprecision(1) << hold
+             << setw(16) << grant << '\n';
+    }
+
+    cout << '\n' << setw(10) << "threads" << setw(16) << "mutex Mops/s" << setw(16) << "cas Mops/s"
+         << setw(18) << "request Mops/s" << '\n';
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        int cycles = 400000 / threads;
+        double locked = bench_contention<LockedRunway, LockedParkingStand>(threads, cycles, mutex_reserve,
+                                                                           mutex_release);
+        double cas = bench_contention<Runway, ParkingStand>(threads, cycles, cas_reserve, cas_release);
+        double request = bench_request_contention(threads, cycles / 4);
+        cout << setw(10) << threads << setw(16) << fixed << setprecision(2) << locked
+             << setw(16) << cas << setw(18) << request << '\n';
+    }
+
+    cout << '\n' << setw(10) << "threads" << setw(16) << "1-lock Mops/s" << setw(16) << "shard Mops/s" << '\n';
+    for (int threads = 1; threads <= 16; threads *= 2) {
+        int lookups = 2000000 / threads;
+        double single = bench_registry<SingleLockRegistry>(threads, lookups);
+        double sharded = bench_registry<ParkingRegistry>(threads, lookups);
+        cout << setw(10) << threads << setw(16) << fixed << setprecision(2) << single
+             << setw(16) << sharded << '\n';
+    }
+
+    cout << "\nwaves (M movements/s)\n" << setw(10) << "aircraft" << setw(12) << "single" << setw(12) << "batch"
+         << '\n';
+    const int wave_sizes[] = {50, 10000};
+    for (int n : wave_sizes) {
+        int waves = 500000 / n;
+        cout << setw(10) << n << setprecision(3) << setw(12) << bench_waves(n, waves, false)
+             << setw(12) << bench_waves(n, waves, true) << '\n';
+    }
+
+    bench_priority(2000);
+
+    cout << "\nstats record: " << setprecision(1) << bench_stats_record(10000000) << " ns/op\n";
+    {
+        shared_ptr<TimerService> timer = make_shared<TimerService>(1);
+        CachedClock cached(timer, microseconds(100));
+        double direct = bench_clock(*timer, 10000000);
+        cout << "clock read: timer " << setprecision(1) << direct << " ns, cached " << bench_clock(cached, 10000000)
+             << " ns\n";
+    }
+    cout << "trace record: " << setprecision(1) << bench_trace_record(10000000) << " ns/op\n";
+    bench_snapshot(64, 100000);
+    bench_layout(64, 1000000);
+    bench_journal(50, 5000);
+    bench_random(20000000);
+
+    cout << '\n';
+    for (bool logged : {false, true}) {
+        SimTraffic traffic(256, 4096, 1024, 2000000);
+        if (logged) {
+            Logger::instance().set_output_file("/dev/null");
+            traffic.airport.set_movement_log(true);
+        }
+        auto start = steady_clock::now();
+        traffic.engine->run();
+        Logger::instance().flush();
+        duration<double> elapsed = steady_clock::now() - start;
+        double sim_hours = duration_cast<duration<double>>(traffic.engine->now()).count() / 3600;
+        cout << (logged ? "sim, movement log: " : "sim: ") << traffic.movements << " movements, "
+             << traffic.engine->events_processed() << " events, " << setprecision(2) << sim_hours
+             << " sim hours in " << elapsed.count() << "s wall, " << setprecision(2)
+             << traffic.movements / elapsed.count() / 1e6 << " M movements/s\n";
+    }
+    cout << "log stalls: " << Logger::instance().stalls() << '\n';
+    return 0;
+}
@@ -0,0 +1,24 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include "cached_clock.h"
+
+CachedClock::CachedClock(std::shared_ptr<Scheduler> inner, std::chrono::nanoseconds resolution) :
+        inner(inner), resolution(resolution), cached(inner->now().count()), stopping(false) {
+    refresher = std::thread([this] () {
+        std::unique_lock<std::mutex> guard(c_lock);
+        while (!stop_cv.wait_for(guard, this->resolution, [this] () { return stopping; })) {
+            cached.store(this->inner->now().count(), std::memory_order_relaxed);
+        }
+    });
+}
+
+CachedClock::~CachedClock() {
+    {
+        std::lock_guard<std::mutex> guard(c_lock);
+        stopping = true;
+    }
+    stop_cv.notify_one();
+    refresher.join();
+}
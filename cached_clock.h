@@ -0,0 +1,43 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#ifndef AIRPORTSIMULATOR_CACHED_CLOCK_H
+#define AIRPORTSIMULATOR_CACHED_CLOCK_H
+
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "scheduler.h"
+
+/** Coarse clock for high-rate callers. Wraps another Scheduler and answers now() from a value a
+ * background thread refreshes every `resolution`, so reading the clock is one relaxed load
+ * instead of a clock call. Times lag the wrapped clock by up to one resolution, and tokens
+ * expire that much later. Delayed work still goes to the wrapped scheduler. */
+class CachedClock : public Scheduler {
+private:
+    std::shared_ptr<Scheduler> inner;
+    std::chrono::nanoseconds resolution;
+    std::atomic<int64_t> cached;
+    std::mutex c_lock;
+    std::condition_variable stop_cv;
+    bool stopping;
+    std::thread refresher;
+
+public:
+    CachedClock(std::shared_ptr<Scheduler> inner, std::chrono::nanoseconds resolution);
+    ~CachedClock();
+
+    std::chrono::nanoseconds now() override {
+        return std::chrono::nanoseconds(cached.load(std::memory_order_relaxed));
+    }
+
+    void schedule_after(std::chrono::nanoseconds delay, std::function<void()> fn) override {
+        inner->schedule_after(delay, std::move(fn));
+    }
+};
+
+#endif //AIRPORTSIMULATOR_CACHED_CLOCK_H
@@ -0,0 +1,203 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <algorithm>
+
+#include "free_index.h"
+
+static inline uint64_t pack(uint64_t old_head, uint32_t index) {
+    return (((old_head >> 32) + 1) << 32) | index;
+}
+
+constexpr uint32_t FreeIndex::kNil;
+
+FreeIndex::FreeIndex() : head(kNil) {}
+
+void FreeIndex::grow(uint32_t count) {
+    while (next.size() < count) {
+        next.emplace_back(kNil);
+    }
+}
+
+void FreeIndex::push(uint32_t index) {
+    uint64_t old_head = head.load(std::memory_order_relaxed);
+    uint64_t new_head;
+    do {
+        next[index].store(static_cast<uint32_t>(old_head), std::memory_order_relaxed);
+        new_head = pack(old_head, index);
+    } while (!head.compare_exchange_weak(old_head, new_head,
+                                         std::memory_order_release, std::memory_order_relaxed));
+}
+
+/*
+ * @param index: receives the popped index
+ * @return : false if there was nothing to pop
+ */
+bool FreeIndex::pop(uint32_t &index) {
+    uint64_t old_head = head.load(std::memory_order_acquire);
+    for (;;) {
+        uint32_t top = static_cast<uint32_t>(old_head);
+        if (top == kNil) {
+            return false;
+        }
+        uint64_t new_head = pack(old_head, next[top].load(std::memory_order_relaxed));
+        if (head.compare_exchange_weak(old_head, new_head,
+                                       std::memory_order_acquire, std::memory_order_acquire)) {
+            index = top;
+            return true;
+        }
+    }
+}
+
+/*
+ * Links indices into a chain first, so only the tail has to be hooked onto the head in the CAS loop.
+ */
+void FreeIndex::push_many(const std::vector<uint32_t> &indices) {
+    if (indices.empty()) {
+        return;
+    }
+    for (size_t i = 0; i + 1 < indices.size(); ++i) {
+        next[indices[i]].store(indices[i + 1], std::memory_order_relaxed);
+    }
+    uint32_t last = indices.back();
+    uint64_t old_head = head.load(std::memory_order_relaxed);
+    uint64_t new_head;
+    do {
+        next[last].store(static_cast<uint32_t>(old_head), std::memory_order_relaxed);
+        new_head = pack(old_head, indices.front());
+    } while (!head.compare_exchange_weak(old_head, new_head,
+                                         std::memory_order_release, std::memory_order_relaxed));
+}
+
+/*
+ * Walks up to count links below the head and cuts them off in one CAS. Every push and pop
+ * bumps the tag, so a CAS that succeeds proves nobody touched the stack during the walk.
+ * @param count: most indices to pop
+ * @param out: popped indices are appended here
+ * @return : number of indices popped
+ */
+size_t FreeIndex::pop_many(size_t count, std::vector<uint32_t> &out) {
+    size_t base = out.size();
+    uint64_t old_head = head.load(std::memory_order_acquire);
+    for (;;) {
+        out.resize(base);
+        uint32_t top = static_cast<uint32_t>(old_head);
+        while (top != kNil && out.size() - base < count) {
+            out.push_back(top);
+            top = next[top].load(std::memory_order_relaxed);
+        }
+        if (out.size() == base) {
+            return 0;
+        }
+        if (head.compare_exchange_weak(old_head, pack(old_head, top),
+                                       std::memory_order_acquire, std::memory_order_acquire)) {
+            return out.size() - base;
+        }
+    }
+}
+
+bool FreeIndex::empty() const {
+    return static_cast<uint32_t>(head.load(std::memory_order_acquire)) == kNil;
+}
+
+ShardedFreeIndex::ShardedFreeIndex(unsigned count) {
+    reset(count);
+}
+
+void ShardedFreeIndex::reset(unsigned count) {
+    shards.clear();
+    for (unsigned i = 0; i < std::max(count, 1u); ++i) {
+        shards.emplace_back(new FreeIndex());
+    }
+    globals.assign(shards.size(), std::vector<uint32_t>());
+    homes.clear();
+    locals.clear();
+}
+
+uint32_t ShardedFreeIndex::add(unsigned shard) {
+    uint32_t index = static_cast<uint32_t>(homes.size());
+    uint32_t local = static_cast<uint32_t>(globals[shard].size());
+    homes.push_back(shard);
+    locals.push_back(local);
+    globals[shard].push_back(index);
+    shards[shard]->grow(local + 1);
+    return index;
+}
+
+void ShardedFreeIndex::reserve(size_t count) {
+    homes.reserve(count);
+    locals.reserve(count);
+    for (auto &global : globals) {
+        global.reserve(count / globals.size() + 1);
+    }
+}
+
+unsigned ShardedFreeIndex::local_shard() const {
+    static std::atomic<unsigned> next_thread {0};
+    static thread_local unsigned thread = next_thread++;
+    return shards.size() == 1 ? 0 : thread % static_cast<unsigned>(shards.size());
+}
+
+void ShardedFreeIndex::push(uint32_t index) {
+    shards[homes[index]]->push(locals[index]);
+}
+
+/*
+ * @param index: receives the popped index
+ * @param start: the shard to try first; the others follow in order
+ * @return : false if every shard was empty
+ */
+bool ShardedFreeIndex::pop(uint32_t &index, unsigned start) {
+    unsigned count = static_cast<unsigned>(shards.size());
+    for (unsigned i = 0; i < count; ++i) {
+        unsigned shard = start + i < count ? start + i : start + i - count;
+        uint32_t local;
+        if (shards[shard]->pop(local)) {
+            index = globals[shard][local];
+            return true;
+        }
+    }
+    return false;
+}
+
+void ShardedFreeIndex::push_many(const std::vector<uint32_t> &indices) {
+    if (indices.empty()) {
+        return;
+    }
+    std::vector<std::vector<uint32_t>> by_shard(shards.size());
+    for (uint32_t index : indices) {
+        by_shard[homes[index]].push_back(locals[index]);
+    }
+    for (size_t shard = 0; shard < shards.size(); ++shard) {
+        shards[shard]->push_many(by_shard[shard]);
+    }
+}
+
+/*
+ * Takes what the start shard has, then steals the rest from the following shards.
+ * @return : number of indices popped
+ */
+size_t ShardedFreeIndex::pop_many(size_t count, std::vector<uint32_t> &out, unsigned start) {
+    size_t base = out.size();
+    unsigned num_shards = static_cast<unsigned>(shards.size());
+    std::vector<uint32_t> popped;
+    for (unsigned i = 0; i < num_shards && out.size() - base < count; ++i) {
+        unsigned shard = start + i < num_shards ? start + i : start + i - num_shards;
+        popped.clear();
+        shards[shard]->pop_many(count - (out.size() - base), popped);
+        for (uint32_t local : popped) {
+            out.push_back(globals[shard][local]);
+        }
+    }
+    return out.size() - base;
+}
+
+bool ShardedFreeIndex::empty() const {
+    for (auto &shard : shards) {
+        if (!shard->empty()) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#ifndef AIRPORTSIMULATOR_FREE_INDEX_H
+#define AIRPORTSIMULATOR_FREE_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <atomic>
+#include <vector>
+#include <memory>
+
+/** Lock-free stack of free resource indices. Push and pop are O(1), so finding a free
+ * resource does not depend on how many resources the airport has.
+ * The head packs a 32-bit tag next to the top index so a pop cannot be fooled by ABA. */
+class FreeIndex {
+private:
+    static constexpr uint32_t kNil = 0xFFFFFFFF;
+
+    std::atomic<uint64_t> head;
+    char pad[64 - sizeof(std::atomic<uint64_t>)];   // keep the head on its own cache line
+    std::deque<std::atomic<uint32_t>> next;          // next[i]: index below i on the stack
+
+public:
+    FreeIndex();
+    /** Makes room for indices [0, count). Not thread-safe, like adding resources. */
+    void grow(uint32_t count);
+    void push(uint32_t index);
+    bool pop(uint32_t &index);
+    /** Pushes every index in indices with a single CAS on the head. */
+    void push_many(const std::vector<uint32_t> &indices);
+    /** Pops up to count indices off the top with a single CAS, appending them to out.
+     * Returns how many were popped. */
+    size_t pop_many(size_t count, std::vector<uint32_t> &out);
+    bool empty() const;
+};
+
+/** FreeIndex split into shards, e.g. one per core or per terminal, so threads working on
+ * different shards do not fight over one head. Every index has a home shard and always goes
+ * back there. A pop starts at a given shard, by default the calling thread's own, and steals
+ * from the following shards in turn once that one is empty. With one shard this is a plain
+ * FreeIndex. */
+class ShardedFreeIndex {
+private:
+    std::vector<std::unique_ptr<FreeIndex>> shards;
+    std::vector<std::vector<uint32_t>> globals;     // per shard: local index -> index
+    std::vector<uint32_t> homes;                    // index -> home shard
+    std::vector<uint32_t> locals;                   // index -> local index in its home shard
+
+public:
+    explicit ShardedFreeIndex(unsigned count = 1);
+    /** Starts over with count empty shards. Not thread-safe, like adding resources. */
+    void reset(unsigned count);
+    /** Registers the next index, homed on shard; it is not free until pushed. Not thread-safe,
+     * like adding resources. */
+    uint32_t add(unsigned shard);
+    /** Makes room for count indices in all, dealt out evenly, for bulk construction. */
+    void reserve(size_t count);
+    unsigned shard_count() const { return static_cast<unsigned>(shards.size()); }
+    unsigned home_of(uint32_t index) const { return homes[index]; }
+    /** The calling thread's shard: threads are spread over the shards in the order they first ask. */
+    unsigned local_shard() const;
+
+    void push(uint32_t index);
+    bool pop(uint32_t &index) { return pop(index, local_shard()); }
+    bool pop(uint32_t &index, unsigned start);
+    /** Each index goes back to its home shard, with one CAS per shard touched. */
+    void push_many(const std::vector<uint32_t> &indices);
+    size_t pop_many(size_t count, std::vector<uint32_t> &out) { return pop_many(count, out, local_shard()); }
+    size_t pop_many(size_t count, std::vector<uint32_t> &out, unsigned start);
+    bool empty() const;
+};
+
+#endif //AIRPORTSIMULATOR_FREE_INDEX_H
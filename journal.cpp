@@ -0,0 +1,402 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#include "journal.h"
+#include "snapshot.h"
+
+static const char kJournalMagic[8] = {'A', 'J', 'O', 'U', 'R', 'N', 'A', 'L'};
+static const size_t kJournalHeaderSize = 16;
+
+/** Longest aircraft id kept whole; a record and its tails must fit in half a buffer. */
+static const size_t kJournalMaxId = kJournalRingSize / 2 * kJournalIdChars;
+
+/** How long the writer sleeps when nobody asks it to write, as for the Logger's flusher. */
+static constexpr std::chrono::milliseconds kMinWriteInterval(1);
+static constexpr std::chrono::milliseconds kMaxWriteInterval(64);
+
+static std::atomic<uint64_t> journal_serials {0};
+
+static void put_varint(std::string &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static void put_zigzag(std::string &out, int64_t value) {
+    put_varint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+/** Reads a journal back, throwing once it runs past the end. */
+class JournalReader {
+private:
+    const unsigned char *at;
+    const unsigned char *end;
+
+public:
+    JournalReader(const char *begin, size_t size) :
+            at(reinterpret_cast<const unsigned char *>(begin)), end(at + size) {}
+
+    bool done() const { return at == end; }
+    const char *position() const { return reinterpret_cast<const char *>(at); }
+
+    uint8_t byte() {
+        if (at == end) {
+            throw std::runtime_error("Journal is truncated");
+        }
+        return *at++;
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = byte();
+            value |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Journal is corrupt");
+    }
+
+    int64_t zigzag() {
+        uint64_t value = varint();
+        return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+
+    void text(std::string &out, size_t length) {
+        if (length > static_cast<size_t>(end - at)) {
+            throw std::runtime_error("Journal is truncated");
+        }
+        out.append(reinterpret_cast<const char *>(at), length);
+        at += length;
+    }
+};
+
+static bool is_request(JournalEvent event) {
+    return event == JournalEvent::RequestLanding || event == JournalEvent::RequestTakeoff ||
+           event == JournalEvent::RequestLandingAsync || event == JournalEvent::RequestTakeoffAsync;
+}
+
+static bool is_batch(JournalEvent event) {
+    return event == JournalEvent::RequestLandingBatch || event == JournalEvent::RequestTakeoffBatch ||
+           event == JournalEvent::PerformLandingBatch || event == JournalEvent::PerformTakeoffBatch;
+}
+
+/*
+ * Appends one record in its on-disk form.
+ * @param previous: time of the block's previous record, updated
+ */
+static void encode(std::string &out, const JournalRecord &record, int64_t &previous) {
+    out.push_back(static_cast<char>(record.event));
+    if (record.event == JournalEvent::IdTail) {
+        put_varint(out, record.length);
+        out.append(record.aircraft, record.length);
+        return;
+    }
+    put_zigzag(out, record.time - previous);
+    previous = record.time;
+    JournalEvent event = record.event;
+    if (is_request(event)) {
+        out.push_back(static_cast<char>(record.outcome));
+        out.push_back(static_cast<char>(record.priority));
+        put_varint(out, record.length);
+        out.append(record.aircraft, record.length);
+        if (record.outcome != 1) {
+            return;                         // Hold or refused: no token
+        }
+    }
+    else if (is_batch(event)) {
+        out.push_back(static_cast<char>(record.outcome));
+        put_varint(out, static_cast<uint64_t>(record.expiration));
+        return;
+    }
+    else if (event == JournalEvent::Grant) {
+        out.push_back(static_cast<char>(record.outcome));
+        out.push_back(static_cast<char>(record.priority));
+    }
+    else if (event == JournalEvent::Expire) {
+        out.push_back(static_cast<char>(record.priority));
+    }
+    else if (event == JournalEvent::PerformLanding || event == JournalEvent::PerformTakeoff) {
+        out.push_back(static_cast<char>(record.outcome));
+    }
+    put_varint(out, record.runway);
+    put_varint(out, record.parking_stand);
+    if (event == JournalEvent::CompleteLanding || event == JournalEvent::CompleteTakeoff) {
+        return;
+    }
+    put_varint(out, record.epoch);
+    if (event != JournalEvent::Expire) {
+        put_zigzag(out, record.expiration - record.time);
+    }
+}
+
+/*
+ * The inverse of encode(). IdTail records are folded into the entry before them.
+ * @param previous: time of the block's previous record, updated
+ */
+static void decode(JournalReader &in, std::vector<JournalEntry> &entries, uint32_t thread, int64_t &previous) {
+    uint8_t event_byte = in.byte();
+    if (event_byte >= kJournalEvents) {
+        throw std::runtime_error("Journal is corrupt");
+    }
+    JournalEvent event = static_cast<JournalEvent>(event_byte);
+    if (event == JournalEvent::IdTail) {
+        if (entries.empty()) {
+            throw std::runtime_error("Journal is corrupt");
+        }
+        size_t length = static_cast<size_t>(in.varint());
+        in.text(entries.back().aircraft, length);
+        return;
+    }
+    JournalEntry entry;
+    entry.event = event;
+    entry.thread = thread;
+    entry.time = previous + in.zigzag();
+    previous = entry.time;
+    entry.expiration = 0;
+    entry.runway = entry.parking_stand = 0xFFFFFFFF;
+    entry.epoch = 0;
+    entry.outcome = 0;
+    entry.priority = 0;
+    bool token = true;
+    if (is_request(event)) {
+        entry.outcome = in.byte();
+        entry.priority = in.byte();
+        in.text(entry.aircraft, static_cast<size_t>(in.varint()));
+        token = entry.outcome == 1;
+    }
+    else if (is_batch(event)) {
+        entry.outcome = in.byte();
+        entry.expiration = static_cast<int64_t>(in.varint());
+        token = false;
+    }
+    else if (event == JournalEvent::Grant) {
+        entry.outcome = in.byte();
+        entry.priority = in.byte();
+    }
+    else if (event == JournalEvent::Expire) {
+        entry.priority = in.byte();
+    }
+    else if (event == JournalEvent::PerformLanding || event == JournalEvent::PerformTakeoff) {
+        entry.outcome = in.byte();
+    }
+    if (token) {
+        entry.runway = static_cast<uint32_t>(in.varint());
+        entry.parking_stand = static_cast<uint32_t>(in.varint());
+        if (event != JournalEvent::CompleteLanding && event != JournalEvent::CompleteTakeoff) {
+            entry.epoch = static_cast<uint32_t>(in.varint());
+            if (event != JournalEvent::Expire) {
+                entry.expiration = entry.time + in.zigzag();
+            }
+        }
+    }
+    entries.push_back(std::move(entry));
+}
+
+Journal::Journal(const std::string &path) : serial(++journal_serials) {
+    file.open(path, std::ios::binary | std::ios::trunc);
+    char header[kJournalHeaderSize] = {};
+    memcpy(header, kJournalMagic, sizeof(kJournalMagic));
+    memcpy(header + sizeof(kJournalMagic), &kJournalVersion, sizeof(kJournalVersion));
+    if (!file || !file.write(header, sizeof(header))) {
+        throw std::runtime_error("Cannot write " + path);
+    }
+    written = sizeof(header);
+    writer = std::thread([this] () { writer_loop(); });
+}
+
+Journal::~Journal() {
+    {
+        std::lock_guard<std::mutex> guard(w_lock);
+        stopping = true;
+    }
+    writer_cv.notify_one();
+    writer.join();
+    for (JournalRing *ring : rings) {
+        delete ring;
+    }
+}
+
+/*
+ * A thread keeps its buffer of every journal it appends to, looked up by the journal's serial
+ * so a buffer of a destroyed journal is never used again. Buffers are the journal's and live as
+ * long as it does.
+ */
+Journal::JournalRing *Journal::thread_ring() {
+    static thread_local std::vector<std::pair<uint64_t, JournalRing *>> mine;
+    for (auto &entry : mine) {
+        if (entry.first == serial) {
+            return entry.second;
+        }
+    }
+    JournalRing *ring = new JournalRing();
+    {
+        std::lock_guard<std::mutex> guard(rings_lock);
+        ring->number = static_cast<uint32_t>(rings.size());
+        rings.push_back(ring);
+    }
+    if (mine.size() >= 16) {
+        mine.erase(mine.begin());           // most likely a journal that is gone
+    }
+    mine.emplace_back(serial, ring);
+    return ring;
+}
+
+/*
+ * As Logger::reserve(): the writer is woken early once a buffer is half full.
+ */
+JournalRecord &Journal::reserve(JournalRing *ring, uint64_t head) {
+    uint64_t used = head - ring->tail.load(std::memory_order_acquire);
+    if (used >= kJournalRingSize / 2) {
+        writer_cv.notify_one();
+        if (used >= kJournalRingSize) {
+            ++stalled;
+            do {
+                std::this_thread::yield();
+                writer_cv.notify_one();
+            } while (head - ring->tail.load(std::memory_order_acquire) >= kJournalRingSize);
+        }
+    }
+    return ring->records[head & (kJournalRingSize - 1)];
+}
+
+/*
+ * A record and the IdTail records of a long id are published together, so the writer never
+ * sees one without the other.
+ */
+void Journal::append(const JournalRecord &record, const std::string &aircraft) {
+    JournalRing *ring = thread_ring();
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    size_t length = std::min(aircraft.size(), kJournalMaxId);
+    size_t used = std::min(length, kJournalIdChars);
+    JournalRecord &first = reserve(ring, head);
+    first = record;
+    first.length = static_cast<uint8_t>(used);
+    memcpy(first.aircraft, aircraft.data(), used);
+    uint64_t next = head + 1;
+    for (size_t done = used; done < length; done += kJournalIdChars, ++next) {
+        JournalRecord &tail = reserve(ring, next);
+        tail.event = JournalEvent::IdTail;
+        tail.length = static_cast<uint8_t>(std::min(length - done, kJournalIdChars));
+        memcpy(tail.aircraft, aircraft.data() + done, tail.length);
+    }
+    ring->head.store(next, std::memory_order_release);
+    appended.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*
+ * Encodes every published record of every buffer into batch, one block per buffer.
+ * @return : records encoded
+ */
+size_t Journal::drain(std::string &batch) {
+    std::vector<JournalRing *> snapshot;
+    {
+        std::lock_guard<std::mutex> guard(rings_lock);
+        snapshot = rings;
+    }
+    size_t drained = 0;
+    std::string block;
+    for (JournalRing *ring : snapshot) {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        if (tail == head) {
+            continue;
+        }
+        block.clear();
+        int64_t base = ring->records[tail & (kJournalRingSize - 1)].time;
+        int64_t previous = base;
+        for (uint64_t at = tail; at != head; ++at) {
+            encode(block, ring->records[at & (kJournalRingSize - 1)], previous);
+        }
+        ring->tail.store(head, std::memory_order_release);
+        put_varint(batch, ring->number);
+        put_varint(batch, head - tail);
+        put_varint(batch, block.size());
+        put_zigzag(batch, base);
+        batch += block;
+        drained += head - tail;
+    }
+    return drained;
+}
+
+/*
+ * Same rounds as Logger::flusher_loop(): note the flush generation, drain every buffer into one
+ * batch, append it with a single write.
+ */
+void Journal::writer_loop() {
+    std::string batch;
+    std::chrono::milliseconds interval = kMinWriteInterval;
+    std::unique_lock<std::mutex> guard(w_lock);
+    for (;;) {
+        if (flush_requested == flush_done && !stopping) {
+            writer_cv.wait_for(guard, interval);
+        }
+        uint64_t generation = flush_requested;
+        bool stop = stopping;
+        guard.unlock();
+        batch.clear();
+        size_t drained = drain(batch);
+        guard.lock();
+        if (drained) {
+            file.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+            file.flush();
+            written += batch.size();
+            interval = kMinWriteInterval;
+        }
+        else {
+            interval = std::min(interval * 2, kMaxWriteInterval);
+        }
+        flush_done = generation;
+        written_cv.notify_all();
+        if (stop) {
+            return;
+        }
+    }
+}
+
+void Journal::flush() {
+    std::unique_lock<std::mutex> guard(w_lock);
+    uint64_t generation = ++flush_requested;
+    writer_cv.notify_one();
+    written_cv.wait(guard, [this, generation] () { return flush_done >= generation; });
+}
+
+std::vector<JournalEntry> read_journal(const std::string &path) {
+    MappedFile file(path);
+    uint32_t version = 0;
+    if (file.size() < kJournalHeaderSize || memcmp(file.data(), kJournalMagic, sizeof(kJournalMagic)) != 0) {
+        throw std::runtime_error("Not an airport journal");
+    }
+    memcpy(&version, file.data() + sizeof(kJournalMagic), sizeof(version));
+    if (version != kJournalVersion) {
+        throw std::runtime_error("Unsupported journal version");
+    }
+    std::vector<JournalEntry> entries;
+    JournalReader in(file.data() + kJournalHeaderSize, file.size() - kJournalHeaderSize);
+    while (!in.done()) {
+        uint32_t thread = static_cast<uint32_t>(in.varint());
+        uint64_t count = in.varint();
+        uint64_t size = in.varint();
+        int64_t previous = in.zigzag();
+        const char *start = in.position();
+        for (uint64_t i = 0; i < count; ++i) {
+            decode(in, entries, thread, previous);
+        }
+        if (static_cast<uint64_t>(in.position() - start) != size) {
+            throw std::runtime_error("Journal is corrupt");
+        }
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](const JournalEntry &x, const JournalEntry &y) {
+        return x.time != y.time ? x.time < y.time : x.thread < y.thread;
+    });
+    return entries;
+}
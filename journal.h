@@ -0,0 +1,148 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#ifndef AIRPORTSIMULATOR_JOURNAL_H
+#define AIRPORTSIMULATOR_JOURNAL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+/** Bumped whenever the encoding below changes; older journals are refused, not converted. */
+static constexpr uint32_t kJournalVersion = 1;
+
+/** What a journal record is. Client calls come first: a replay feeds those back to an airport.
+ * The rest is what the airport did on its own, kept to compare against and to pace the replay.
+ * A batch call is one record giving the count, followed by one record per element. */
+enum class JournalEvent : uint8_t {
+    RequestLanding, RequestTakeoff, RequestLandingAsync, RequestTakeoffAsync,
+    PerformLanding, PerformTakeoff,
+    RequestLandingBatch, RequestTakeoffBatch, PerformLandingBatch, PerformTakeoffBatch,
+    Grant, CompleteLanding, CompleteTakeoff, Expire,
+    IdTail
+};
+static constexpr int kJournalEvents = 15;
+
+/** Outcome of a request that threw, e.g. a takeoff for an aircraft that is not parked here. */
+static constexpr uint8_t kJournalRefused = 0xFF;
+
+/** Priority of a takeoff's grant or expiry, which have no landing class. */
+static constexpr uint8_t kJournalTakeoff = 0xFF;
+
+/** Aircraft id bytes one record carries; longer ids continue in IdTail records. */
+static constexpr size_t kJournalIdChars = 32;
+
+/** Records per thread buffer. */
+static constexpr uint32_t kJournalRingSize = 4096;
+
+/** One fixed-size record, as a thread appends it. Times are the airport's scheduler nanoseconds.
+ * outcome is the AirportState of a request or grant, 1 if a perform started, or kJournalRefused.
+ * priority is the LandingPriority of a landing request, grant or expiry, or kJournalTakeoff.
+ * expiration holds a token's expiration, or the size of a batch. */
+struct JournalRecord {
+    int64_t time;
+    int64_t expiration;
+    uint32_t runway;
+    uint32_t parking_stand;
+    uint32_t epoch;
+    JournalEvent event;
+    uint8_t outcome;
+    uint8_t priority;
+    uint8_t length;                     // aircraft bytes used
+    char aircraft[kJournalIdChars];
+};
+
+static_assert(sizeof(JournalRecord) == 64, "one record per cache line");
+
+/** A record read back, with its aircraft id whole. thread numbers the buffers that wrote it. */
+struct JournalEntry {
+    int64_t time;
+    int64_t expiration;
+    uint32_t runway;
+    uint32_t parking_stand;
+    uint32_t epoch;
+    uint32_t thread;
+    JournalEvent event;
+    uint8_t outcome;
+    uint8_t priority;
+    std::string aircraft;
+};
+
+/** Append-only binary journal of what an airport was asked and did, see Airport::set_journal().
+ * A thread copies its record into its own buffer; one background writer encodes the buffers in
+ * batches and appends them to the file. A full buffer makes its thread wait for the writer,
+ * nothing is dropped.
+ *
+ * On disk: a 16-byte header ("AJOURNAL", version, 0), then blocks of one buffer's records:
+ * varint buffer number, varint record count, varint byte length, zigzag varint base time, then
+ * the records. Each record is its event byte and zigzag varint time delta from the previous
+ * record of the block, then only the fields its event uses: outcome and priority bytes,
+ * varints for handles and epoch, a zigzag varint expiration relative to its time, and a
+ * length-prefixed aircraft id. A request for a short id takes about 25 bytes, a completion 4 to
+ * 8, which the writer spends instead of the thread that made the call. */
+class Journal {
+private:
+    /** Single producer (the owning thread), single consumer (the writer). */
+    struct JournalRing {
+        std::atomic<uint64_t> head {0};     // records ever written, stored by the producer
+        char pad[64 - sizeof(std::atomic<uint64_t>)];
+        std::atomic<uint64_t> tail {0};     // records ever encoded, stored by the writer
+        uint32_t number;
+        JournalRecord records[kJournalRingSize];
+    };
+
+    const uint64_t serial;                  // tells this journal's buffers from a dead one's
+    std::mutex rings_lock;
+    std::vector<JournalRing *> rings;       // one per thread that ever appended
+
+    std::mutex w_lock;                      // writer state and file
+    std::condition_variable writer_cv;
+    std::condition_variable written_cv;
+    uint64_t flush_requested = 0;
+    uint64_t flush_done = 0;
+    bool stopping = false;
+    std::ofstream file;
+    std::atomic<uint64_t> appended {0};
+    std::atomic<uint64_t> written {0};      // bytes
+    std::atomic<uint64_t> stalled {0};
+    std::thread writer;
+
+    JournalRing *thread_ring();
+    JournalRecord &reserve(JournalRing *ring, uint64_t head);
+    void writer_loop();
+    size_t drain(std::string &batch);
+
+public:
+    /** Truncates path and starts the writer. Throws if the file cannot be created. */
+    explicit Journal(const std::string &path);
+    /** Writes everything appended and closes the file. */
+    ~Journal();
+    Journal(const Journal &) = delete;
+    Journal &operator=(const Journal &) = delete;
+
+    /** Queues record, with aircraft copied into it. Its own aircraft and length are ignored. */
+    void append(const JournalRecord &record, const std::string &aircraft = std::string());
+    /** Returns once everything appended before the call, by any thread, is in the file. */
+    void flush();
+
+    uint64_t records() const { return appended.load(std::memory_order_relaxed); }
+    uint64_t bytes() const { return written.load(std::memory_order_relaxed); }
+    /** Records that had to wait for room in a full buffer. */
+    uint64_t stalls() const { return stalled.load(std::memory_order_relaxed); }
+};
+
+/*
+ * Decodes a whole journal. Records of one thread keep their order; the threads are merged by
+ * time, ties going to the lower buffer number.
+ * @return : every record, oldest first; throws if the file is not a journal or is cut short
+ */
+std::vector<JournalEntry> read_journal(const std::string &path);
+
+#endif //AIRPORTSIMULATOR_JOURNAL_H
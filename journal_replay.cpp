@@ -0,0 +1,97 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <cstring>
+#include <stdexcept>
+
+#include "airport.h"
+#include "sim_engine.h"
+#include "snapshot.h"
+#include "journal.h"
+#include "replay.h"
+#include "trace.h"
+
+using namespace std;
+
+static const char *kJournalEventNames[kJournalEvents] = {
+    "request_landing", "request_takeoff", "request_landing_async", "request_takeoff_async",
+    "perform_landing", "perform_takeoff",
+    "request_landing_batch", "request_takeoff_batch", "perform_landing_batch", "perform_takeoff_batch",
+    "grant", "complete_landing", "complete_takeoff", "expire", "id_tail"
+};
+
+/*
+ * Replays a journal (see Airport::set_journal()) against the snapshot taken when it started, on
+ * a SimEngine at full speed, and reports whether the airport did the same again. Built with
+ * AIRPORT_TRACE, --trace dumps the replay's trace for AirportTraceExport, so an incident can be
+ * profiled from its journal instead of by re-running the load.
+ * Usage: AirportReplay journal snapshot [--trace dump]
+ */
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        cerr << "usage: " << argv[0] << " journal snapshot [--trace dump]\n";
+        return 1;
+    }
+    string trace_path;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--trace")) {
+            trace_path = argv[i + 1];
+        }
+        else {
+            cerr << "unknown option " << argv[i] << '\n';
+            return 1;
+        }
+    }
+    try {
+        vector<JournalEntry> entries = read_journal(argv[1]);
+        int64_t saved_at;
+        {
+            MappedFile file(argv[2]);
+            saved_at = snapshot_header(file).saved_at;
+        }
+        uint64_t counts[kJournalEvents] = {};
+        for (auto &entry : entries) {
+            ++counts[static_cast<int>(entry.event)];
+        }
+
+        shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+        engine->run_until(chrono::nanoseconds(saved_at));
+        Airport airport(engine);
+        airport.restore(argv[2]);
+        ReplayStats stats = replay_journal(entries, airport, *engine);
+
+        double span = entries.empty() ? 0 : (entries.back().time - entries.front().time) / 1e9;
+        double wall = max(stats.wall_sec, 1e-9);
+        cout << entries.size() << " records over " << fixed << setprecision(3) << span << "s\n";
+        for (int e = 0; e < kJournalEvents; ++e) {
+            if (counts[e]) {
+                cout << setw(24) << kJournalEventNames[e] << setw(12) << counts[e] << '\n';
+            }
+        }
+        cout << "\nreplayed " << stats.calls << " calls in " << wall << "s, " << setprecision(0)
+             << stats.calls / wall << " calls/s, " << setprecision(1) << span / wall << "x the original\n";
+        if (stats.diverged) {
+            const JournalEntry &first = entries[stats.first_divergence];
+            cout << stats.diverged << " calls diverged, first " << kJournalEventNames[static_cast<int>(first.event)]
+                 << " of " << first.aircraft << " at " << setprecision(6)
+                 << (first.time - entries.front().time) / 1e9 << "s\n";
+        }
+        else {
+            cout << "every call came out as journaled\n";
+        }
+        if (!trace_path.empty() && !trace_dump(trace_path)) {
+            cerr << "cannot write " << trace_path << '\n';
+            return 1;
+        }
+        return stats.diverged ? 2 : 0;
+    }
+    catch (runtime_error &e) {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,132 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "layout.h"
+#include "snapshot.h"
+
+void LayoutIds::add(const char *id, size_t length, unsigned shard) {
+    text.append(id, length);
+    ends.push_back(text.size());
+    shards.push_back(shard);
+}
+
+void LayoutIds::reserve(size_t count, size_t text_bytes) {
+    text.reserve(text_bytes);
+    ends.reserve(count);
+    shards.reserve(count);
+}
+
+std::string LayoutIds::id(size_t i) const {
+    size_t begin = i ? ends[i - 1] : 0;
+    return text.substr(begin, ends[i] - begin);
+}
+
+static inline bool blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/*
+ * @param at: moved past the token and the blanks before it
+ * @return : the length of the token starting at at, 0 at the end of the line
+ */
+static size_t next_token(const char *&at, const char *end) {
+    while (at < end && blank(*at)) {
+        ++at;
+    }
+    const char *start = at;
+    while (at < end && !blank(*at)) {
+        ++at;
+    }
+    size_t length = static_cast<size_t>(at - start);
+    at = start;
+    return length;
+}
+
+static std::runtime_error layout_error(size_t line, const char *what) {
+    return std::runtime_error("Layout line " + std::to_string(line) + ": " + what);
+}
+
+Layout parse_layout(const char *data, size_t size) {
+    Layout layout;
+    const char *end_of_data = data + size;
+    size_t line = 0;
+    for (const char *at = data; at < end_of_data; ) {
+        ++line;
+        const char *newline = static_cast<const char *>(memchr(at, '\n', static_cast<size_t>(end_of_data - at)));
+        const char *end = newline ? newline : end_of_data;
+        const char *comment = static_cast<const char *>(memchr(at, '#', static_cast<size_t>(end - at)));
+        const char *content_end = comment ? comment : end;
+
+        size_t length = next_token(at, content_end);
+        if (length) {
+            LayoutIds *ids;
+            if (length == 6 && !memcmp(at, "runway", 6)) {
+                ids = &layout.runways;
+            }
+            else if (length == 5 && !memcmp(at, "stand", 5)) {
+                ids = &layout.parking_stands;
+            }
+            else {
+                throw layout_error(line, "unknown resource kind");
+            }
+            at += length;
+            size_t id_length = next_token(at, content_end);
+            if (!id_length) {
+                throw layout_error(line, "missing id");
+            }
+            const char *id = at;
+            at += id_length;
+            unsigned shard = kAnyShard;
+            size_t shard_length = next_token(at, content_end);
+            if (shard_length) {
+                uint64_t value = 0;
+                for (size_t i = 0; i < shard_length; ++i) {
+                    if (at[i] < '0' || at[i] > '9' || value >= kAnyShard / 10) {
+                        throw layout_error(line, "bad shard");
+                    }
+                    value = value * 10 + static_cast<uint64_t>(at[i] - '0');
+                }
+                shard = static_cast<unsigned>(value);
+                at += shard_length;
+                if (next_token(at, content_end)) {
+                    throw layout_error(line, "unexpected text after the shard");
+                }
+            }
+            ids->add(id, id_length, shard);
+        }
+        at = newline ? newline + 1 : end_of_data;
+    }
+    return layout;
+}
+
+Layout read_layout(const std::string &path) {
+    MappedFile file(path);
+    return parse_layout(file.data(), file.size());
+}
+
+void write_layout(const std::string &path, const Layout &layout) {
+    std::string text;
+    auto write_ids = [&text] (const char *kind, const LayoutIds &ids) {
+        for (size_t i = 0; i < ids.size(); ++i) {
+            text += kind;
+            text += ' ';
+            text += ids.id(i);
+            if (ids.shard(i) != kAnyShard) {
+                text += ' ';
+                text += std::to_string(ids.shard(i));
+            }
+            text += '\n';
+        }
+    };
+    write_ids("runway", layout.runways);
+    write_ids("stand", layout.parking_stands);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out || !out.write(text.data(), text.size())) {
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
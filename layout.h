@@ -0,0 +1,64 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#ifndef AIRPORTSIMULATOR_LAYOUT_H
+#define AIRPORTSIMULATOR_LAYOUT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/** Shard of a layout resource that did not name one: dealt out in turn, as by add_runway(). */
+static constexpr unsigned kAnyShard = ~0u;
+
+/** Ids of one kind of resource in file order, their text back to back in one buffer, so a
+ * million stands are a few allocations rather than a million. */
+class LayoutIds {
+private:
+    std::string text;
+    std::vector<uint64_t> ends;         // end of each id in text
+    std::vector<unsigned> shards;
+
+public:
+    void add(const char *id, size_t length, unsigned shard);
+    void add(const std::string &id, unsigned shard = kAnyShard) { add(id.data(), id.size(), shard); }
+    void reserve(size_t count, size_t text_bytes);
+
+    size_t size() const { return ends.size(); }
+    std::string id(size_t i) const;
+    unsigned shard(size_t i) const { return shards[i]; }
+};
+
+/** The runways and parking stands of an airport, as Airport::load_layout() builds them.
+ *
+ * The file is text, one resource per line, ids being runs of anything but blanks:
+ *
+ *     # comments run from '#' to the end of the line
+ *     runway r_0
+ *     runway r_1 2        <- on shard 2
+ *     stand p_0
+ *
+ * Blank lines are skipped and CRLF line ends are fine. */
+struct Layout {
+    LayoutIds runways;
+    LayoutIds parking_stands;
+};
+
+/*
+ * One pass over the text, no copies but the ids themselves.
+ * @return : the layout; throws naming the line of the first error
+ */
+Layout parse_layout(const char *data, size_t size);
+
+/*
+ * Maps the file and parses it in place.
+ * @return : the layout; throws if the file cannot be read or parsed
+ */
+Layout read_layout(const std::string &path);
+
+/** Throws if the file cannot be written. */
+void write_layout(const std::string &path, const Layout &layout);
+
+#endif //AIRPORTSIMULATOR_LAYOUT_H
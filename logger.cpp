@@ -0,0 +1,186 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+#include "logger.h"
+
+/** How long the flusher sleeps when nobody asks it to write: the shortest right after a round
+ * that wrote something, doubling while rounds find nothing. */
+static constexpr std::chrono::milliseconds kMinFlushInterval(1);
+static constexpr std::chrono::milliseconds kMaxFlushInterval(64);
+
+/** The calling thread's buffer, taken on its first message and handed back when it exits.
+ * Whatever the thread left in it is still written, before anything its next owner logs. The
+ * holder owns the logger, so a thread exiting after main() does not hand its buffer back to a
+ * destroyed one. */
+class LogRingHolder {
+public:
+    std::shared_ptr<Logger> owner;
+    Logger::LogRing *ring;
+
+    LogRingHolder() : owner(Logger::shared()), ring(owner->take_ring()) {}
+
+    ~LogRingHolder() {
+        owner->give_back(ring);
+    }
+};
+
+Logger::Logger() : out(&std::cout) {
+    flusher = std::thread([this] () { flusher_loop(); });
+}
+
+Logger::~Logger() {
+    halted = true;
+    {
+        std::lock_guard<std::mutex> guard(f_lock);
+        stopping = true;
+    }
+    flusher_cv.notify_one();
+    flusher.join();
+    for (LogRing *ring : rings) {
+        delete ring;
+    }
+}
+
+const std::shared_ptr<Logger> &Logger::shared() {
+    static std::shared_ptr<Logger> logger(new Logger());
+    return logger;
+}
+
+Logger::LogRing *Logger::take_ring() {
+    std::lock_guard<std::mutex> guard(rings_lock);
+    if (free_rings.empty()) {
+        rings.push_back(new LogRing());
+        return rings.back();
+    }
+    LogRing *ring = free_rings.back();
+    free_rings.pop_back();
+    return ring;
+}
+
+void Logger::give_back(LogRing *ring) {
+    std::lock_guard<std::mutex> guard(rings_lock);
+    free_rings.push_back(ring);
+}
+
+Logger::LogRing *Logger::thread_ring() {
+    static thread_local LogRingHolder holder;
+    return holder.ring;
+}
+
+/*
+ * The flusher is only woken early once a buffer is half full; below that it picks the entries
+ * up on its next round, so logging costs no system call. Once the logger is being destroyed
+ * the flusher may be gone, so a full buffer drops the message instead of waiting for it.
+ */
+Logger::LogEntry *Logger::reserve(LogRing *ring, uint64_t head) {
+    uint64_t used = head - ring->tail.load(std::memory_order_acquire);
+    if (used >= kLogRingSize / 2) {
+        flusher_cv.notify_one();
+        if (used >= kLogRingSize) {
+            ++stalled;
+            do {
+                if (halted.load()) {
+                    ++dropped_records;
+                    return nullptr;
+                }
+                std::this_thread::yield();
+                flusher_cv.notify_one();
+            } while (head - ring->tail.load(std::memory_order_acquire) >= kLogRingSize);
+        }
+    }
+    return &ring->entries[head & (kLogRingSize - 1)];
+}
+
+/*
+ * Formats every published entry of every buffer into batch.
+ * @return : entries formatted
+ */
+size_t Logger::drain(std::ostream &batch) {
+    std::vector<LogRing *> snapshot;
+    {
+        std::lock_guard<std::mutex> guard(rings_lock);
+        snapshot = rings;
+    }
+    size_t drained = 0;
+    for (LogRing *ring : snapshot) {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail) {
+            LogEntry &entry = ring->entries[tail & (kLogRingSize - 1)];
+            entry.emit(batch, &entry.payload);
+            ++drained;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    return drained;
+}
+
+/*
+ * One round: note the flush generation, drain every buffer into one batch, write it with a
+ * single call. Anything logged before a flush() is published before its generation is noted,
+ * so that round picks it up.
+ */
+void Logger::flusher_loop() {
+    std::ostringstream batch;
+    std::chrono::milliseconds interval = kMinFlushInterval;
+    std::unique_lock<std::mutex> guard(f_lock);
+    for (;;) {
+        if (flush_requested == flush_done && !stopping) {
+            flusher_cv.wait_for(guard, interval);
+        }
+        uint64_t generation = flush_requested;
+        bool stop = stopping;
+        guard.unlock();
+        batch.str(std::string());
+        size_t drained = drain(batch);
+        guard.lock();
+        if (drained) {
+            const std::string text = batch.str();
+            out->write(text.data(), static_cast<std::streamsize>(text.size()));
+            out->flush();
+            interval = kMinFlushInterval;
+        }
+        else {
+            interval = std::min(interval * 2, kMaxFlushInterval);
+        }
+        flush_done = generation;
+        flushed_cv.notify_all();
+        if (stop) {
+            return;
+        }
+    }
+}
+
+void Logger::flush() {
+    std::unique_lock<std::mutex> guard(f_lock);
+    uint64_t generation = ++flush_requested;
+    flusher_cv.notify_one();
+    flushed_cv.wait(guard, [this, generation] () { return flush_done >= generation; });
+}
+
+void Logger::set_output(std::ostream &out) {
+    flush();
+    std::lock_guard<std::mutex> guard(f_lock);
+    this->out = &out;
+    if (file.is_open() && &out != &file) {
+        file.close();
+    }
+}
+
+bool Logger::set_output_file(const std::string &path) {
+    flush();
+    std::lock_guard<std::mutex> guard(f_lock);
+    std::ofstream opened(path, std::ios::trunc);
+    if (!opened) {
+        return false;
+    }
+    file.close();
+    file.swap(opened);
+    out = &file;
+    return true;
+}
@@ -0,0 +1,175 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#ifndef AIRPORTSIMULATOR_LOGGER_H
+#define AIRPORTSIMULATOR_LOGGER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <tuple>
+#include <sstream>
+#include <fstream>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/** Bytes of arguments a log entry carries; bigger messages are formatted by the caller. */
+static constexpr size_t kLogPayloadSize = 112;
+
+/** Entries per thread buffer. */
+static constexpr uint32_t kLogRingSize = 1024;
+
+/** How a log argument is kept until the flusher formats it. Character pointers and arrays,
+ * literals included, are copied into a string, since the buffer behind them may be gone by
+ * then. Everything else is kept by value. */
+template<typename T, typename D = typename std::decay<T>::type>
+struct LogArg {
+    typedef D type;
+};
+
+template<typename T>
+struct LogArg<T, const char *> {
+    typedef std::string type;
+};
+
+template<typename T>
+struct LogArg<T, char *> {
+    typedef std::string type;
+};
+
+/** Asynchronous logger. A thread appends its arguments, unformatted, to its own buffer; one
+ * background flusher formats the buffers in batches and writes them out. Messages of one thread
+ * keep their order, messages of different threads may interleave differently than they were
+ * logged. A full buffer makes its thread wait for the flusher, nothing is dropped. */
+class Logger {
+private:
+    /** Arguments of one message, formatted and destroyed by emit on the flusher thread. */
+    struct LogEntry {
+        void (*emit)(std::ostream &out, void *payload);
+        typename std::aligned_storage<kLogPayloadSize, alignof(std::max_align_t)>::type payload;
+    };
+
+    /** Single producer (the owning thread), single consumer (the flusher). */
+    struct LogRing {
+        std::atomic<uint64_t> head {0};     // entries ever written, stored by the producer
+        char pad[64 - sizeof(std::atomic<uint64_t>)];
+        std::atomic<uint64_t> tail {0};     // entries ever emitted, stored by the flusher
+        LogEntry entries[kLogRingSize];
+    };
+
+    friend class LogRingHolder;
+
+    std::mutex rings_lock;
+    std::vector<LogRing *> rings;           // every buffer ever made
+    std::vector<LogRing *> free_rings;      // buffers of threads that have exited
+
+    std::mutex f_lock;                      // flusher state and output
+    std::condition_variable flusher_cv;
+    std::condition_variable flushed_cv;
+    uint64_t flush_requested = 0;
+    uint64_t flush_done = 0;
+    bool stopping = false;
+    std::atomic<bool> halted {false};       // set once ~Logger starts; nothing empties a full buffer then
+    std::ostream *out;
+    std::ofstream file;
+    std::atomic<uint64_t> stalled {0};
+    std::atomic<uint64_t> dropped_records {0};
+    std::thread flusher;
+
+    Logger();
+    LogRing *thread_ring();
+    LogRing *take_ring();
+    void give_back(LogRing *ring);
+    /** Waits for room in ring, returns the slot to fill; null if the logger is going away. */
+    LogEntry *reserve(LogRing *ring, uint64_t head);
+    void flusher_loop();
+    size_t drain(std::ostream &batch);
+
+    template<size_t I, size_t N>
+    struct Printer {
+        template<typename Tuple>
+        static void print(std::ostream &out, const Tuple &args) {
+            out << std::get<I>(args);
+            Printer<I + 1, N>::print(out, args);
+        }
+    };
+
+    template<size_t N>
+    struct Printer<N, N> {
+        template<typename Tuple>
+        static void print(std::ostream &, const Tuple &) {}
+    };
+
+    template<typename Tuple>
+    static void emit(std::ostream &out, void *payload) {
+        Tuple *args = static_cast<Tuple *>(payload);
+        Printer<0, std::tuple_size<Tuple>::value>::print(out, *args);
+        args->~Tuple();
+    }
+
+    template<typename Tuple, typename ...Args>
+    void append(std::true_type, Args &&...args) {
+        LogRing *ring = thread_ring();
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        LogEntry *entry = reserve(ring, head);
+        if (!entry) {
+            return;
+        }
+        new (&entry->payload) Tuple(std::forward<Args>(args)...);
+        entry->emit = &emit<Tuple>;
+        ring->head.store(head + 1, std::memory_order_release);
+    }
+
+    /* Too big for an entry: format here and log the text. */
+    template<typename Tuple, typename ...Args>
+    void append(std::false_type, Args &&...args) {
+        std::ostringstream text;
+        Tuple copy(std::forward<Args>(args)...);
+        Printer<0, std::tuple_size<Tuple>::value>::print(text, copy);
+        log(text.str());
+    }
+
+public:
+    /** The process-wide logger; its flusher starts on first use. */
+    static Logger &instance() { return *shared(); }
+    /** The same logger, owned: it lives until the last owner is gone. Every thread that logs owns
+     * it until it exits, so a thread outliving main() still has it. */
+    static const std::shared_ptr<Logger> &shared();
+    /** Flushes everything logged and stops the flusher. */
+    ~Logger();
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    /** Queues the arguments, to be written one after the other as by operator<<. */
+    template<typename ...Args>
+    void log(Args &&...args) {
+        typedef std::tuple<typename LogArg<Args &&>::type...> Tuple;
+        append<Tuple>(std::integral_constant<bool, sizeof(Tuple) <= kLogPayloadSize &&
+                                                   alignof(Tuple) <= alignof(std::max_align_t)>(),
+                      std::forward<Args>(args)...);
+    }
+
+    /** Returns once everything logged before the call, by any thread, has been written. */
+    void flush();
+    /** Where the flusher writes, std::cout by default. out must outlive its use. */
+    void set_output(std::ostream &out);
+    /*
+     * Sends the log to a file, truncating it.
+     * @return : if the file could be opened; the output is unchanged otherwise
+     */
+    bool set_output_file(const std::string &path);
+    /** Messages that had to wait for room in a full buffer. */
+    uint64_t stalls() const { return stalled.load(std::memory_order_relaxed); }
+    /** Messages dropped because their buffer was full while the logger was being destroyed. */
+    uint64_t dropped() const { return dropped_records.load(std::memory_order_relaxed); }
+};
+
+#endif //AIRPORTSIMULATOR_LOGGER_H
@@ -1,10 +1,37 @@
 #include <iostream>
 #include <ctime>
 #include <cassert>
+#include <thread>
+#include <future>
+#include <sstream>
+#include <cstdio>
+#include <random>
+#include <functional>
+#include <algorithm>
+#include <tuple>
+#include <numeric>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sys/socket.h>
 
 #include "parking_stand.h"
 #include "runway.h"
 #include "airport.h"
+#include "sim_engine.h"
+#include "timing_wheel.h"
+#include "parking_registry.h"
+#include "trace.h"
+#include "logger.h"
+#include "cached_clock.h"
+#include "timer_service.h"
+#include "network.h"
+#include "snapshot.h"
+#include "journal.h"
+#include "replay.h"
+#include "random.h"
+#include "layout.h"
 
 using namespace std;
 using namespace std::chrono;
@@ -14,22 +41,17 @@ using namespace std::chrono;
  * Basic support for logging and random sleeps. Nothing exciting to see here.
  * @{ */
 
-/** Some simple thread-safe logging functionality. */
-void Log() {}
-
-static recursive_mutex s_mutex;
-
-template<typename First, typename ...Rest>
-void Log(First&& first, Rest&& ...rest) {
-    lock_guard<recursive_mutex> lock(s_mutex);
-    std::cout << std::forward<First>(first);
-    Log(std::forward<Rest>(rest)...);
+/** Some simple thread-safe logging functionality. Formatting and output happen on the logger's
+ * flusher thread, so a message is written a little later and never blocks on the terminal. */
+template<typename ...Args>
+void Log(Args&& ...args) {
+    Logger::instance().log(std::forward<Args>(args)...);
 }
 
-/** Produces a random integer within the [1..max] range. */
+/** Produces a random integer within the [1..max] range, from the calling thread's stream. */
 static int RandomInt(int maxSleep = 6) {
     const int minSleep = 1;
-    return minSleep + (rand() % static_cast<int>(maxSleep - minSleep + 1));
+    return static_cast<int>(thread_random().between(minSleep, maxSleep));
 }
 
 /* Declaration of testing function */
@@ -43,8 +65,39 @@ void test_request_takeoff_success(vector<string>);
 void test_request_takeoff_exception(vector<string>);
 void test_perform_takeoff_success(vector<string>);
 void test_perform_takeoff_exception(vector<string>);
+void test_perform_landing_bulk(int n);
+void test_wait_idle(vector<string>);
+void test_resource_handles(vector<string>);
+void test_resource_views(vector<string>);
+void test_parking_registry(int thr);
+void test_sim_landing_takeoff(vector<string>);
+void test_sim_operation_duration(vector<string>);
+void test_sim_token_expired(vector<string>);
+void test_sim_takeoff_token_expired(vector<string>);
+void test_sim_token_validity(vector<string>);
+void test_cached_clock();
+void test_sim_stale_token(vector<string>);
+void test_sim_batch();
+void test_sharded_free_index();
+void test_sim_shards();
+void test_node_mesh();
+void test_sim_snapshot();
+void test_journal();
+void test_sim_journal_replay();
+void test_random();
+void test_sim_layout();
+void test_sim_wait_queue();
+void test_wait_queue_future(vector<string>);
+void test_wait_queue_race(int t);
+void test_sim_priority();
+void test_stats();
+void test_trace();
+void test_logger();
+void test_timing_wheel();
 void test_request_landing_race1(int t);
 void test_request_landing_race2(int t);
+void test_preempt_race(int t);
+void test_expiry_race(int t);
 
 /* test by EYE(log), not by assertion */
 void test_perform_landing_race(int thr, int num_rw, int num_ps);
@@ -68,9 +121,46 @@ int main() {
     test_request_takeoff_exception(planes);
     test_perform_takeoff_success(planes);
     test_perform_takeoff_exception(planes);
+    test_perform_landing_bulk(500);
+    test_wait_idle(planes);
+    test_resource_handles(planes);
+    test_resource_views(planes);
+    test_parking_registry(8);
+    test_sim_landing_takeoff(planes);
+    test_sim_operation_duration(planes);
+    test_sim_token_expired(planes);
+    test_sim_takeoff_token_expired(planes);
+    test_sim_token_validity(planes);
+    test_cached_clock();
+    test_sim_stale_token(planes);
+    test_sim_batch();
+    test_sharded_free_index();
+    test_sim_shards();
+    test_node_mesh();
+    test_sim_snapshot();
+    test_journal();
+    test_sim_journal_replay();
+    test_random();
+    test_sim_layout();
+    test_sim_wait_queue();
+    test_wait_queue_future(planes);
+    test_sim_priority();
+    test_stats();
+    test_trace();
+    test_logger();
+    test_timing_wheel();
     for (int t = 1; t <= 20; ++t) {
         test_request_landing_race1(t);
     }
+    for (int t = 1; t <= 5; ++t) {
+        test_preempt_race(t);
+    }
+    for (int t = 1; t <= 5; ++t) {
+        test_expiry_race(t);
+    }
+    for (int t = 1; t <= 5; ++t) {
+        test_wait_queue_race(t);
+    }
     for (int t = 1; t <= 20; ++t) {
         test_request_landing_race2(t);
     }
@@ -128,8 +218,10 @@ void test_perform_landing_exception(vector<string> planes) {
     }
     assert(msg == "Token was expired");
     this_thread::sleep_for(seconds(kOperationDurationSec + 1));
-    assert(ps->getState() == ParkingStandState::Reserved);
-    assert(rw->getState() == RunwayState::Reserved);
+    // the lapsed token gave its runway and stand back
+    assert(ps->getState() == ParkingStandState::Available);
+    assert(rw->getState() == RunwayState::Available);
+    assert(airport.request_landing(planes.at(1)).state == AirportState::Proceed);
     Log("[PASS]test_perform_landing_exception\n");
 }
 
@@ -289,6 +381,1278 @@ void test_perform_takeoff_exception(vector<string> planes) {
     Log("[PASS]test_perform_takeoff_exception\n");
 }
 
+/*
+ * Test Case: many operations in flight at once all complete, on the airport's fixed timer threads
+ */
+void test_perform_landing_bulk(int n) {
+    Airport airport {};
+    vector<shared_ptr<ParkingStand>> stands;
+    for (int i = 0; i < n; ++i) {
+        airport.add_runway(make_shared<Runway>(i));
+        stands.push_back(make_shared<ParkingStand>(i));
+        airport.add_parking_stands(stands.back());
+    }
+    for (int i = 0; i < n; ++i) {
+        LandingRequestToken token = airport.request_landing("Aircraft " + to_string(i));
+        assert(token.state == AirportState::Proceed);
+        airport.perform_landing(token);
+    }
+    this_thread::sleep_for(seconds(kOperationDurationSec + 1));
+    for (auto& ps : stands) {
+        assert(ps->getState() == ParkingStandState::Occupied);
+    }
+    Log("[PASS]test_perform_landing_bulk\n");
+}
+
+void test_wait_idle(vector<string> planes) {
+    Airport airport {};
+    shared_ptr<ParkingStand> ps = make_shared<ParkingStand>(0);
+    shared_ptr<Runway> rw = make_shared<Runway>(0);
+    airport.add_runway(rw);
+    airport.add_parking_stands(ps);
+
+    airport.wait_idle();                            // nothing in flight, returns at once
+    airport.perform_landing(airport.request_landing(planes.at(0)));
+    assert(airport.operations_in_flight() == 1);
+    airport.wait_idle();
+    assert(airport.operations_in_flight() == 0);
+    assert(ps->getState() == ParkingStandState::Occupied);
+    assert(rw->getState() == RunwayState::Available);
+    Log("[PASS]test_wait_idle\n");
+}
+
+void test_resource_handles(vector<string> planes) {
+    Airport airport {};
+    shared_ptr<ParkingStand> ps1 = make_shared<ParkingStand>(1);
+    shared_ptr<Runway> rw = make_shared<Runway>(0);
+    airport.add_runway(rw);
+    airport.add_parking_stands(make_shared<ParkingStand>(0));
+    airport.add_parking_stands(ps1);
+    assert(airport.find_runway("r_0") == 0);
+    assert(airport.find_parking_stand("p_1") == 1);
+    assert(airport.find_parking_stand("p_9") == kInvalidHandle);
+
+    LandingRequestToken token1 = airport.request_landing(planes.at(0));
+    assert(token1.state == AirportState::Proceed);
+    assert(airport.runway(token1.runway) == rw);
+    assert(airport.parking_stand(token1.parking_stand)->getState() == ParkingStandState::Reserved);
+
+    LandingRequestToken forged = token1;
+    forged.runway = 7;
+    string msg = "";
+    try {
+        airport.perform_landing(forged);
+    }
+    catch (runtime_error& e) {
+        msg.append(static_cast<string>(e.what()));
+    }
+    assert(msg == "Invalid Input");
+    Log("[PASS]test_resource_handles\n");
+}
+
+/*
+ * Test Case: a runway added to an airport is a view of the airport's store, both ways
+ */
+void test_resource_views(vector<string> planes) {
+    Airport airport {};
+    shared_ptr<Runway> rw = make_shared<Runway>(0);
+    rw->setState(RunwayState::Reserved);
+    airport.add_runway(rw);
+    airport.add_parking_stands(make_shared<ParkingStand>(0));
+    assert(rw->getState() == RunwayState::Reserved);
+    assert(airport.request_landing(planes.at(0)).state == AirportState::Hold);
+    assert(airport.runway(0) == rw);
+
+    Airport other {};
+    string msg = "";
+    try {
+        other.add_runway(rw);
+    }
+    catch (runtime_error& e) {
+        msg.append(static_cast<string>(e.what()));
+    }
+    assert(msg == "Runway already belongs to an airport");
+    Log("[PASS]test_resource_views\n");
+}
+
+void test_parking_registry(int thr) {
+    ParkingRegistry registry;
+    vector<shared_ptr<thread>> clients;
+    for (int i = 0; i < thr; ++i) {
+        clients.push_back(make_shared<thread>([&registry, i]() {
+            for (int j = 0; j < 1000; ++j) {
+                string id = "Aircraft " + to_string(i) + "_" + to_string(j);
+                ResourceHandle ps = kInvalidHandle;
+                registry.insert(id, static_cast<ResourceHandle>(j));
+                assert(registry.find(id, ps) && ps == static_cast<ResourceHandle>(j));
+                if (j % 2 == 0) {
+                    assert(registry.erase(id));
+                    assert(!registry.find(id, ps));
+                }
+            }
+        }));
+    }
+    for (auto client : clients) {
+        client->join();
+    }
+    assert(registry.size() == static_cast<size_t>(thr) * 500);
+    Log("[PASS]test_parking_registry\n");
+}
+
+void test_sim_landing_takeoff(vector<string> planes) {
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    Airport airport {engine};
+    shared_ptr<ParkingStand> ps = make_shared<ParkingStand>(0);
+    shared_ptr<Runway> rw = make_shared<Runway>(0);
+    airport.add_runway(rw);
+    airport.add_parking_stands(ps);
+
+    LandingRequestToken token1 = airport.request_landing(planes.at(0));
+    airport.perform_landing(token1);
+    assert(rw->getState() == RunwayState::InOperation);
+    engine->run();                                  // no real sleeping
+    assert(engine->now() == seconds(kOperationDurationSec));
+    assert(ps->getState() == ParkingStandState::Occupied);
+    assert(rw->getState() == RunwayState::Available);
+
+    TakeOffRequestToken token2 = airport.request_takeoff(planes.at(0));
+    airport.perform_takeoff(token2);
+    engine->run();
+    assert(engine->now() == seconds(2 * kOperationDurationSec));
+    assert(ps->getState() == ParkingStandState::Available);
+    assert(rw->getState() == RunwayState::Available);
+    Log("[PASS]test_sim_landing_takeoff\n");
+}
+
+void test_sim_operation_duration(vector<string> planes) {
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    Airport airport {engine};
+    airport.set_operation_duration(milliseconds(1500));
+    airport.add_runway(make_shared<Runway>(0));
+    airport.add_parking_stands(make_shared<ParkingStand>(0));
+
+    airport.perform_landing(airport.request_landing(planes.at(0)));
+    engine->run_until(milliseconds(1499));
+    assert(airport.runway(0)->getState() == RunwayState::InOperation);
+    engine->run_until(milliseconds(1500));
+    assert(airport.runway(0)->getState() == RunwayState::Available);
+    assert(airport.parking_stand(0)->getState() == ParkingStandState::Occupied);
+    engine->run();
+    Log("[PASS]test_sim_operation_duration\n");
+}
+
+void test_sim_token_expired(vector<string> planes) {
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    Airport airport {engine};
+    shared_ptr<ParkingStand> ps = make_shared<ParkingStand>(0);
+    shared_ptr<Runway> rw = make_shared<Runway>(0);
+    airport.add_runway(rw);
+    airport.add_parking_stands(ps);
+
+    LandingRequestToken token1 = airport.request_landing(planes.at(0));
+    string msg = "";
+    engine->schedule_after(seconds(kTokenValiditySec + 2), [&airport, &token1, &msg]() {
+        try {
+            airport.perform_landing(token1);
+        }
+        catch (runtime_error& e) {
+            msg.append(static_cast<string>(e.what()));
+        }
+    });
+    engine->run();
+    assert(msg == "Token was expired");
+    assert(ps->getState() == ParkingStandState::Available);
+    assert(rw->getState() == RunwayState::Available);
+    Log("[PASS]test_sim_token_expired\n");
+}
+
+void test_sim_takeoff_token_expired(vector<string> planes) {
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    Airport airport {engine};
+    shared_ptr<ParkingStand> ps = make_shared<ParkingStand>(0);
+    shared_ptr<Runway> rw = make_shared<Runway>(0);
+    airport.add_runway(rw);
+    airport.add_parking_stands(ps);
+
+    airport.perform_landing(airport.request_landing(planes.at(0)));
+    engine->run();
+    TakeOffRequestToken token1 = airport.request_takeoff(planes.at(0));
+    assert(token1.state == AirportState::Proceed);
+    engine->run();                                  // let the token lapse
+    assert(rw->getState() == RunwayState::Available);
+    assert(ps->getState() == ParkingStandState::Occupied);
+    TakeOffRequestToken token2 = airport.request_takeoff(planes.at(0));
+    assert(token2.state == AirportState::Proceed);
+    Log("[PASS]test_sim_takeoff_token_expired\n");
+}
+
+void test_sim_token_validity(vector<string> planes) {
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    Airport airport {engine};
+    shared_ptr<Runway> rw = make_shared<Runway>(0);
+    airport.add_runway(rw);
+    airport.add_parking_stands(make_shared<ParkingStand>(0));
+    airport.add_parking_stands(make_shared<ParkingStand>(1));
+    airport.set_operation_duration(milliseconds(1));
+    airport.set_token_validity(milliseconds(3));
+
+    LandingRequestToken token1 = airport.request_landing(planes.at(0));
+    assert(token1.expiration == milliseconds(3));
+    engine->run_until(milliseconds(3));
+    assert(airport.perform_landing(token1));            // valid up to and including its expiration
+    engine->run();
+
+    LandingRequestToken token2 = airport.request_landing(planes.at(1));
+    nanoseconds issued = engine->now();
+    engine->run_until(issued + milliseconds(3) + nanoseconds(1));
+    try {
+        airport.perform_landing(token2);
+        assert(false);
+    }
+    catch (runtime_error& e) {
+        assert(static_cast<string>(e.what()) == "Token was expired");
+    }
+    assert(rw->getState() == RunwayState::Reserved);    // reclaimed on the next 1 ms tick
+    engine->run_until(issued + milliseconds(4));
+    assert(rw->getState() == RunwayState::Available);
+    uint64_t events = engine->events_processed();
+    engine->run();
+    assert(engine->events_processed() == events);       // no ticks once nothing is left to expire
+    Log("[PASS]test_sim_token_validity\n");
+}
+
+void test_cached_clock() {
+    shared_ptr<TimerService> timer = make_shared<TimerService>(1);
+    CachedClock clock(timer, milliseconds(1));
+    nanoseconds before = clock.now();
+    this_thread::sleep_for(milliseconds(20));
+    nanoseconds after = clock.now();
+    assert(after - before >= milliseconds(10) && after <= timer->now());
+    Log("[PASS]test_cached_clock\n");
+}
+
+void test_sim_stale_token(vector<string> planes) {
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    Airport airport {engine};
+    airport.add_runway(make_shared<Runway>(0));
+    airport.add_parking_stands(make_shared<ParkingStand>(0));
+
+    LandingRequestToken routine = airport.request_landing(planes.at(0));
+    LandingRequestToken copy = routine;                 // a plain value, no strings
+    assert(airport.aircraft_of(copy) == planes.at(0));
+    LandingRequestToken emergency = airport.request_landing(planes.at(1), LandingPriority::Emergency);
+    assert(emergency.runway == routine.runway && emergency.epoch != routine.epoch);
+    assert(airport.aircraft_of(routine).empty() && airport.aircraft_of(emergency) == planes.at(1));
+    try {
+        airport.perform_landing(copy);                  // still in time, but for a reservation that is gone
+        assert(false);
+    }
+    catch (runtime_error& e) {
+        assert(static_cast<string>(e.what()) == "Runway is not reserved");
+    }
+    assert(airport.perform_landing(emergency));
+    engine->run();
+    assert(airport.request_takeoff(planes.at(1)).state == AirportState::Proceed);
+    Log("[PASS]test_sim_stale_token\n");
+}
+
+void test_sim_batch() {
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    Airport airport {engine};
+    for (int i = 0; i < 3; ++i) {
+        airport.add_runway(make_shared<Runway>(i));
+    }
+    for (int i = 0; i < 2; ++i) {
+        airport.add_parking_stands(make_shared<ParkingStand>(i));
+    }
+    vector<string> wave;
+    for (int i = 0; i < 4; ++i) {
+        wave.push_back("Aircraft " + to_string(i));
+    }
+
+    vector<LandingRequestToken> landings = airport.request_landing_batch(wave);
+    assert(landings.size() == 4);
+    assert(landings[0].state == AirportState::Proceed && landings[1].state == AirportState::Proceed);
+    assert(landings[2].state == AirportState::Hold && landings[3].state == AirportState::Hold);
+    assert(landings[0].parking_stand != landings[1].parking_stand);
+    assert(airport.request_landing(wave.at(2)).state == AirportState::Hold);   // no stand left
+
+    vector<bool> started = airport.perform_landing_batch(landings);
+    assert(started[0] && started[1] && !started[2] && !started[3]);
+    assert(airport.operations_in_flight() == 1);        // one completion for the wave
+    engine->run();
+    assert(airport.parking_stand(landings[0].parking_stand)->getState() == ParkingStandState::Occupied);
+    assert(airport.parking_stand(landings[1].parking_stand)->getState() == ParkingStandState::Occupied);
+
+    string msg = "";
+    try {
+        airport.request_takeoff_batch(wave);
+    }
+    catch (runtime_error& e) {
+        msg.append(static_cast<string>(e.what()));
+    }
+    assert(msg == "This airport does not have this plane");
+
+    wave.resize(2);
+    vector<TakeOffRequestToken> takeoffs = airport.request_takeoff_batch(wave);
+    assert(takeoffs[0].state == AirportState::Proceed && takeoffs[1].state == AirportState::Proceed);
+    started = airport.perform_takeoff_batch(takeoffs);
+    assert(started[0] && started[1]);
+    started = airport.perform_takeoff_batch(takeoffs);   // already in operation
+    assert(!started[0] && !started[1]);
+    engine->run();
+    for (int i = 0; i < 2; ++i) {
+        assert(airport.parking_stand(i)->getState() == ParkingStandState::Available);
+    }
+    for (int i = 0; i < 3; ++i) {
+        assert(airport.runway(i)->getState() == RunwayState::Available);
+    }
+    assert(airport.request_landing_batch(wave)[1].state == AirportState::Proceed);
+    Log("[PASS]test_sim_batch\n");
+}
+
+void test_sharded_free_index() {
+    ShardedFreeIndex index {2};
+    assert(index.add(0) == 0 && index.add(1) == 1 && index.add(0) == 2);
+    assert(index.home_of(1) == 1 && index.home_of(2) == 0);
+    assert(index.local_shard() < 2);
+    for (uint32_t i = 0; i < 3; ++i) {
+        index.push(i);
+    }
+
+    uint32_t idx;
+    assert(index.pop(idx, 1) && idx == 1);      // own shard first
+    assert(index.pop(idx, 1) && idx == 2);      // then steals from shard 0
+    index.push(1);
+    index.push(2);
+    assert(index.pop(idx, 1) && idx == 1);      // each index went back home
+    index.push(1);
+
+    vector<uint32_t> out;
+    assert(index.pop_many(5, out, 0) == 3 && out.size() == 3);
+    assert(out[0] == 2 || out[0] == 0);
+    assert(index.empty() && !index.pop(idx));
+    index.push_many(out);
+    assert(index.pop(idx, 1) && idx == 1);
+    Log("[PASS]test_sharded_free_index\n");
+}
+
+/*
+ * Test Case: a landing gets a stand of its runway's shard, and steals a runway from another
+ * shard only once its own shard has none
+ */
+void test_sim_shards() {
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    Airport airport {engine};
+    airport.set_shards(2);
+    assert(airport.shards() == 2);
+    for (unsigned i = 0; i < 2; ++i) {
+        airport.add_runway(make_shared<Runway>(i), i);
+        airport.add_parking_stands(make_shared<ParkingStand>(i), i);
+    }
+
+    string msg = "";
+    try {
+        airport.set_shards(4);
+    }
+    catch (runtime_error& e) {
+        msg.append(static_cast<string>(e.what()));
+    }
+    assert(msg == "Shards must be set before adding resources");
+    msg = "";
+    try {
+        airport.add_runway(make_shared<Runway>(2), 2);
+    }
+    catch (runtime_error& e) {
+        msg.append(static_cast<string>(e.what()));
+    }
+    assert(msg == "This airport does not have this shard");
+
+    vector<LandingRequestToken> tokens;
+    for (int i = 0; i < 2; ++i) {
+        tokens.push_back(airport.request_landing("Aircraft " + to_string(i)));
+        assert(tokens.back().state == AirportState::Proceed);
+        assert(tokens.back().runway == tokens.back().parking_stand);    // runway i is on shard i, as is stand i
+    }
+    assert(tokens[0].runway != tokens[1].runway);
+    assert(airport.request_landing("Aircraft 2").state == AirportState::Hold);
+    for (auto &token : tokens) {
+        assert(airport.perform_landing(token));
+    }
+    engine->run();
+    assert(airport.request_takeoff("Aircraft 0").state == AirportState::Proceed);
+    Log("[PASS]test_sim_shards\n");
+}
+
+/*
+ * Test Case: two nodes swap batches, one far bigger than a socket buffer and one empty, then
+ * node 0 gathers the stats
+ */
+void test_node_mesh() {
+    int sv[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    NodeMesh mesh0 {0, {-1, sv[0]}};
+    NodeMesh mesh1 {1, {sv[1], -1}};
+    const size_t sizes[] = {200000, 0, 3};
+    NodeStats stats0, stats1;
+    stats1.movements = 7;
+    vector<FlightMessage> received[2][3];
+
+    auto run = [&](NodeMesh &mesh, NodeStats &stats) {
+        unsigned self = mesh.node_id();
+        vector<vector<FlightMessage>> outgoing(2);
+        for (uint64_t w = 0; w < 3; ++w) {
+            for (size_t i = 0; i < sizes[w]; ++i) {
+                outgoing[1 - self].push_back({i, static_cast<int64_t>(w), 1 - self, self});
+            }
+            mesh.exchange(w, outgoing, received[self][w], stats);
+            assert(outgoing[1 - self].empty());
+        }
+    };
+    thread peer([&]() {
+        run(mesh1, stats1);
+        assert(mesh1.gather(stats1).empty());
+    });
+    run(mesh0, stats0);
+    vector<NodeStats> all = mesh0.gather(stats0);
+    peer.join();
+
+    for (unsigned self = 0; self < 2; ++self) {
+        for (uint64_t w = 0; w < 3; ++w) {
+            assert(received[self][w].size() == sizes[w]);
+            for (size_t i = 0; i < sizes[w]; ++i) {
+                const FlightMessage &flight = received[self][w][i];
+                assert(flight.aircraft == i && flight.arrival == static_cast<int64_t>(w));
+                assert(flight.destination == self && flight.origin == 1 - self);
+            }
+        }
+    }
+    assert(stats0.batches == 3 && stats0.bytes > 200000 * sizeof(FlightMessage));
+    assert(all.size() == 2 && all[1].movements == 7 && all[1].batches == 3);
+    Log("[PASS]test_node_mesh\n");
+}
+
+/*
+ * Test Case: a restored airport carries on with a parked aircraft, a landing and a takeoff in
+ * operation and a reservation whose token is still in the client's hands
+ */
+void test_sim_snapshot() {
+    const string path = "/tmp/airport_test_snapshot.bin";
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    Airport airport {engine};
+    for (int i = 0; i < 3; ++i) {
+        airport.add_runway(make_shared<Runway>(i));
+    }
+    for (int i = 0; i < 4; ++i) {
+        airport.add_parking_stands(make_shared<ParkingStand>(i));
+    }
+    assert(airport.perform_landing(airport.request_landing("A")));
+    engine->run();
+    LandingRequestToken reserved = airport.request_landing("B");
+    assert(airport.perform_landing(airport.request_landing("C")));
+    TakeOffRequestToken takeoff = airport.request_takeoff("A");
+    assert(airport.perform_takeoff(takeoff));
+    airport.snapshot(path);
+
+    shared_ptr<SimEngine> engine2 = make_shared<SimEngine>();
+    Airport restored {engine2};
+    restored.restore(path);
+    for (uint32_t i = 0; i < 3; ++i) {
+        assert(restored.runway(i)->getState() == airport.runway(i)->getState());
+        assert(restored.find_runway("r_" + to_string(i)) == i);
+    }
+    for (uint32_t i = 0; i < 4; ++i) {
+        assert(restored.parking_stand(i)->getState() == airport.parking_stand(i)->getState());
+        assert(restored.find_parking_stand("p_" + to_string(i)) == i);
+    }
+    shared_ptr<Runway> first_runway = restored.runway(0), last_runway = restored.runway(2);
+    // One block for all runways: the views share a single owner.
+    assert(!first_runway.owner_before(last_runway) && !last_runway.owner_before(first_runway));
+    assert(restored.operations_in_flight() == 2);
+    assert(restored.aircraft_of(reserved) == "B");
+    assert(restored.perform_landing(reserved));
+    engine2->run();
+    assert(restored.parking_stand(takeoff.parking_stand)->getState() == ParkingStandState::Available);
+    assert(restored.request_takeoff("B").state == AirportState::Proceed);
+    assert(restored.request_takeoff("C").state == AirportState::Proceed);
+    string msg = "";
+    try {
+        restored.request_takeoff("A");
+    }
+    catch (runtime_error& e) {
+        msg.append(static_cast<string>(e.what()));
+    }
+    assert(msg == "This airport does not have this plane");
+
+    // Left alone, the reservation lapses and its stand comes back, next to A's.
+    shared_ptr<SimEngine> engine3 = make_shared<SimEngine>();
+    Airport lapsed {engine3};
+    lapsed.restore(path);
+    engine3->run();
+    assert(lapsed.runway(reserved.runway)->getState() == RunwayState::Available);
+    assert(lapsed.parking_stand(reserved.parking_stand)->getState() == ParkingStandState::Available);
+    assert(lapsed.request_landing("D").state == AirportState::Proceed);
+    assert(lapsed.request_landing("E").state == AirportState::Proceed);
+    assert(lapsed.request_landing("F").state == AirportState::Proceed);
+    assert(lapsed.request_landing("G").state == AirportState::Hold);      // three runways; C keeps a stand
+
+    msg = "";
+    try {
+        lapsed.restore(path);
+    }
+    catch (runtime_error& e) {
+        msg.append(static_cast<string>(e.what()));
+    }
+    assert(msg == "Restore needs an airport without resources");
+
+    // A patched copy of the snapshot is refused before anything is added.
+    auto restore_patched = [&airport, &path](function<void(string &, const SnapshotHeader &)> patch) {
+        airport.snapshot(path);
+        ifstream in(path, ios::binary);
+        string bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        SnapshotHeader h;
+        memcpy(&h, bytes.data(), sizeof(h));
+        patch(bytes, h);
+        ofstream(path, ios::binary | ios::trunc).write(bytes.data(), bytes.size());
+        string what = "";
+        Airport corrupt {make_shared<SimEngine>()};
+        try {
+            corrupt.restore(path);
+        }
+        catch (runtime_error& e) {
+            what.append(static_cast<string>(e.what()));
+        }
+        assert(corrupt.find_runway("r_0") == kInvalidHandle);
+        return what;
+    };
+    // A string table whose first end lies past the others would read beyond the string data.
+    assert(restore_patched([](string &bytes, const SnapshotHeader &h) {
+        uint64_t past = bytes.size();
+        memcpy(&bytes[h.string_ends], &past, sizeof(past));
+    }) == "Snapshot is corrupt");
+    // Resources in no known state would be in neither a free index nor the wheel, lost for good.
+    assert(restore_patched([](string &bytes, const SnapshotHeader &h) {
+        bytes[h.runway_states] = 7;             // the state byte of the first runway's word
+    }) == "Snapshot is corrupt");
+    assert(restore_patched([](string &bytes, const SnapshotHeader &h) {
+        bytes[h.parking_stand_states + 3] = 9;
+    }) == "Snapshot is corrupt");
+    FILE *junk = fopen(path.c_str(), "w");
+    fputs("not a snapshot", junk);
+    fclose(junk);
+    msg = "";
+    try {
+        Airport empty {make_shared<SimEngine>()};
+        empty.restore(path);
+    }
+    catch (runtime_error& e) {
+        msg.append(static_cast<string>(e.what()));
+    }
+    assert(msg == "Not an airport snapshot");
+    remove(path.c_str());
+    engine->run();          // the original's operations, before it is destroyed
+    Log("[PASS]test_sim_snapshot\n");
+}
+
+/*
+ * Test Case: records appended by several threads at once come back whole, in each thread's
+ * order, ids longer than a record included
+ */
+void test_journal() {
+    const string path = "/tmp/airport_test_journal.bin";
+    const int threads = 4, per_thread = 5000;          // more than a buffer holds
+    const string long_id = "Aircraft with an id far longer than a single journal record carries";
+    {
+        Journal journal {path};
+        vector<thread> writers;
+        for (int t = 0; t < threads; ++t) {
+            writers.emplace_back([&journal, t, per_thread, &long_id]() {
+                for (int i = 0; i < per_thread; ++i) {
+                    JournalRecord record = {};
+                    record.event = JournalEvent::RequestLanding;
+                    record.time = i * 1000;
+                    record.outcome = static_cast<uint8_t>(AirportState::Proceed);
+                    record.runway = static_cast<uint32_t>(t);
+                    record.parking_stand = static_cast<uint32_t>(i);
+                    record.epoch = static_cast<uint32_t>(i);
+                    record.expiration = record.time + 4000;
+                    journal.append(record, i % 100 == 0 ? long_id : "Aircraft " + to_string(i));
+                }
+            });
+        }
+        for (auto &writer : writers) {
+            writer.join();
+        }
+        journal.flush();
+        assert(journal.records() == uint64_t(threads * per_thread));
+    }
+    vector<JournalEntry> entries = read_journal(path);
+    assert(entries.size() == size_t(threads * per_thread));
+    vector<int> next(threads, 0);
+    for (auto &entry : entries) {
+        int t = static_cast<int>(entry.runway);
+        int i = next[t]++;
+        assert(entry.event == JournalEvent::RequestLanding);
+        assert(entry.epoch == uint32_t(i) && entry.parking_stand == uint32_t(i));
+        assert(entry.time == i * 1000 && entry.expiration == entry.time + 4000);
+        assert(entry.aircraft == (i % 100 == 0 ? long_id : "Aircraft " + to_string(i)));
+    }
+    FILE *junk = fopen(path.c_str(), "w");
+    fputs("not a journal", junk);
+    fclose(junk);
+    string msg = "";
+    try {
+        read_journal(path);
+    }
+    catch (runtime_error& e) {
+        msg.append(static_cast<string>(e.what()));
+    }
+    assert(msg == "Not an airport journal");
+    remove(path.c_str());
+    Log("[PASS]test_journal\n");
+}
+
+/*
+ * Test Case: a journaled day of sync, async and batch traffic, with lapsed tokens, preemptions
+ * and refused takeoffs, replays from its snapshot with every call coming out the same
+ */
+void test_sim_journal_replay() {
+    const string snapshot_path = "/tmp/airport_test_journal.snapshot";
+    const string path = "/tmp/airport_test_journal.bin";
+    const string replay_path = "/tmp/airport_test_replay.bin";
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    Airport airport {engine};
+    for (int i = 0; i < 3; ++i) {
+        airport.add_runway(make_shared<Runway>(i));
+    }
+    for (int i = 0; i < 6; ++i) {
+        airport.add_parking_stands(make_shared<ParkingStand>(i));
+    }
+    airport.snapshot(snapshot_path);
+    shared_ptr<Journal> journal = make_shared<Journal>(path);
+    airport.set_journal(journal);
+
+    mt19937 rng(7);
+    function<void(string, int)> depart = [&](string id, int tries) {
+        TakeOffRequestToken token = airport.request_takeoff(id);
+        if (token.state == AirportState::Proceed) {
+            airport.perform_takeoff(token);
+        }
+        else if (tries < 20) {
+            engine->schedule_after(seconds(10), [&depart, id, tries]() { depart(id, tries + 1); });
+        }
+    };
+    function<void(string)> parked = [&](string id) {
+        engine->schedule_after(seconds(30 + rng() % 90), [&depart, id]() { depart(id, 0); });
+    };
+    function<void(string, int)> arrive = [&](string id, int tries) {
+        LandingRequestToken token = airport.request_landing(id, tries > 3 ? LandingPriority::Emergency
+                                                                           : LandingPriority::Routine);
+        if (token.state == AirportState::Hold) {
+            if (tries < 20) {
+                engine->schedule_after(seconds(10), [&arrive, id, tries]() { arrive(id, tries + 1); });
+            }
+            return;
+        }
+        // Past the 4 s validity the token has lapsed; before that it may have been preempted.
+        engine->schedule_after(seconds(rng() % 7), [&, id, token, tries]() {
+            try {
+                airport.perform_landing(token);
+                parked(id);
+            }
+            catch (runtime_error &) {
+                arrive(id, tries + 1);
+            }
+        });
+    };
+    for (int k = 0; k < 160; ++k) {
+        string id = "Aircraft " + to_string(k) + (k % 10 == 9 ? " of a carrier with ids too long for one record" : "");
+        seconds at(rng() % 900);
+        switch (k % 4) {
+            case 0:
+            case 1:
+                engine->schedule_at(at, [&arrive, id]() { arrive(id, 0); });
+                break;
+            case 2:
+                engine->schedule_at(at, [&, id]() {
+                    airport.request_landing_async(id, [&, id](LandingRequestToken token) {
+                        airport.perform_landing(token);
+                        parked(id);
+                    });
+                });
+                break;
+            default:
+                engine->schedule_at(at, [&, id]() {
+                    vector<string> wave {id, id + "b"};
+                    vector<bool> started = airport.perform_landing_batch(airport.request_landing_batch(wave));
+                    for (size_t i = 0; i < wave.size(); ++i) {
+                        if (started[i]) {
+                            parked(wave[i]);
+                        }
+                    }
+                });
+                break;
+        }
+    }
+    engine->schedule_at(seconds(450), [&airport]() {
+        try {
+            airport.request_takeoff("Nobody");
+        }
+        catch (runtime_error &) {
+        }
+        try {
+            airport.request_takeoff_batch({"Nobody", "Nobody else"});
+        }
+        catch (runtime_error &) {
+        }
+    });
+    engine->run();
+    journal->flush();
+
+    vector<JournalEntry> entries = read_journal(path);
+    assert(entries.size() == journal->records());
+    uint64_t counts[kJournalEvents] = {};
+    bool long_id = false;
+    for (auto &entry : entries) {
+        ++counts[static_cast<int>(entry.event)];
+        long_id = long_id || entry.aircraft == "Aircraft 19 of a carrier with ids too long for one record";
+    }
+    assert(long_id);
+    for (JournalEvent event : {JournalEvent::RequestLanding, JournalEvent::RequestTakeoff,
+                               JournalEvent::RequestLandingAsync, JournalEvent::PerformLanding,
+                               JournalEvent::PerformTakeoff, JournalEvent::RequestLandingBatch,
+                               JournalEvent::RequestTakeoffBatch, JournalEvent::PerformLandingBatch,
+                               JournalEvent::Grant, JournalEvent::CompleteLanding,
+                               JournalEvent::CompleteTakeoff, JournalEvent::Expire}) {
+        assert(counts[static_cast<int>(event)] > 0);
+    }
+    assert(airport.preemptions() > 0);
+
+    shared_ptr<SimEngine> engine2 = make_shared<SimEngine>();
+    Airport replayed {engine2};
+    replayed.restore(snapshot_path);
+    shared_ptr<Journal> journal2 = make_shared<Journal>(replay_path);
+    replayed.set_journal(journal2);
+    ReplayStats stats = replay_journal(entries, replayed, *engine2);
+    assert(stats.diverged == 0);
+    assert(stats.grants == counts[static_cast<int>(JournalEvent::Grant)]);
+    journal2->flush();
+    // Events due at the same time may interleave differently around the calls; ordered by
+    // their fields, the two journals are the same.
+    vector<JournalEntry> again = read_journal(replay_path);
+    assert(again.size() == entries.size());
+    auto order = [](const JournalEntry &x, const JournalEntry &y) {
+        return make_tuple(x.time, x.event, x.runway, x.parking_stand, x.epoch, x.aircraft) <
+               make_tuple(y.time, y.event, y.runway, y.parking_stand, y.epoch, y.aircraft);
+    };
+    sort(entries.begin(), entries.end(), order);
+    sort(again.begin(), again.end(), order);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        assert(again[i].event == entries[i].event && again[i].time == entries[i].time);
+        assert(again[i].outcome == entries[i].outcome && again[i].priority == entries[i].priority);
+        assert(again[i].runway == entries[i].runway && again[i].parking_stand == entries[i].parking_stand);
+        assert(again[i].epoch == entries[i].epoch && again[i].expiration == entries[i].expiration);
+        assert(again[i].aircraft == entries[i].aircraft);
+    }
+    for (uint32_t i = 0; i < 3; ++i) {
+        assert(replayed.runway(i)->getState() == airport.runway(i)->getState());
+    }
+    for (uint32_t i = 0; i < 6; ++i) {
+        assert(replayed.parking_stand(i)->getState() == airport.parking_stand(i)->getState());
+    }
+    assert(replayed.preemptions() == airport.preemptions());
+    remove(snapshot_path.c_str());
+    remove(path.c_str());
+    remove(replay_path.c_str());
+    Log("[PASS]test_sim_journal_replay\n");
+}
+
+/*
+ * Test Case: Streams are reproducible and distinct, bulk lanes are jumped scalar streams and the
+ * samplers have the right means
+ */
+void test_random() {
+    // The first draws of seed 42, pinned: a change here changes every seeded run.
+    Xoshiro256 rng(42, 0);
+    assert(rng() == 1865750160070900731ULL);
+    assert(rng() == 6791145067590612263ULL);
+    Xoshiro256 again(42, 0), other(42, 1);
+    again();
+    again();
+    assert(again() == rng());
+    assert(other() != Xoshiro256(42, 0)());
+
+    // Lane 0 is the stream itself, lane 1 the stream jumped once.
+    RandomBulk bulk(42, 0);
+    uint64_t words[4 * kRandomLanes + 1];
+    bulk.fill(words, 4 * kRandomLanes + 1);
+    Xoshiro256 lane0(42, 0), lane1(42, 0);
+    lane1.jump();
+    for (int row = 0; row <= 4; ++row) {
+        assert(words[row * kRandomLanes] == lane0());
+        if (row < 4) {
+            assert(words[row * kRandomLanes + 1] == lane1());
+        }
+    }
+
+    bool low = false, high = false;
+    for (int i = 0; i < 10000; ++i) {
+        int64_t x = rng.between(-2, 2);
+        assert(x >= -2 && x <= 2);
+        low = low || x == -2;
+        high = high || x == 2;
+        assert(rng.below(7) < 7);
+        double u = rng.uniform();
+        assert(u >= 0 && u < 1);
+    }
+    assert(low && high);
+    assert(rng.below(0) == 0);
+
+    const size_t n = 200000;
+    vector<double> samples(n);
+    bulk.fill_uniform(samples.data(), n);
+    assert(*min_element(samples.begin(), samples.end()) >= 0 && *max_element(samples.begin(), samples.end()) < 1);
+    bulk.fill_exponential(samples.data(), n, 3.0);
+    double mean = accumulate(samples.begin(), samples.end(), 0.0) / n;
+    assert(fabs(mean - 3.0) < 0.05);
+    bulk.fill_normal(samples.data(), n - 1, 5.0, 2.0);
+    mean = accumulate(samples.begin(), samples.end() - 1, 0.0) / (n - 1);
+    double variance = 0;
+    for (size_t i = 0; i + 1 < n; ++i) {
+        variance += (samples[i] - mean) * (samples[i] - mean) / (n - 1);
+    }
+    assert(fabs(mean - 5.0) < 0.03 && fabs(sqrt(variance) - 2.0) < 0.03);
+    double exponential_sum = 0, poisson_small = 0, poisson_large = 0, log_sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        exponential_sum += exponential(rng, 0.5);
+        poisson_small += poisson(rng, 3.5);
+        poisson_large += poisson(rng, 120);
+        log_sum += log(lognormal(rng, 1.0, 0.5));
+    }
+    assert(fabs(exponential_sum / n - 0.5) < 0.01);
+    assert(fabs(poisson_small / n - 3.5) < 0.03);
+    assert(fabs(poisson_large / n - 120) < 0.2);
+    assert(fabs(log_sum / n - 1.0) < 0.01);
+
+    DiscreteSampler pick({1, 0, 3, 6});
+    size_t counts[4] = {};
+    for (size_t i = 0; i < n; ++i) {
+        ++counts[pick(rng)];
+    }
+    vector<uint32_t> picks(n);
+    pick.fill(bulk, picks.data(), n);
+    for (uint32_t p : picks) {
+        ++counts[p];
+    }
+    assert(counts[1] == 0);
+    assert(fabs(counts[0] / (2.0 * n) - 0.1) < 0.005 && fabs(counts[3] / (2.0 * n) - 0.6) < 0.005);
+    bool threw = false;
+    try {
+        DiscreteSampler none({0, 0});
+    }
+    catch (runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+
+    // A thread's stream depends on the seed and its number, not on the thread.
+    uint64_t first[2];
+    for (int t = 0; t < 2; ++t) {
+        thread([&first, t]() {
+            set_thread_stream(5);
+            first[t] = thread_random()();
+        }).join();
+    }
+    assert(first[0] == first[1] && first[0] == Xoshiro256(random_seed(), 5)());
+    uint64_t seed = random_seed();
+    set_random_seed(7);
+    thread([]() {
+        set_thread_stream(5);
+        assert(thread_random()() == Xoshiro256(7, 5)());
+    }).join();
+    set_random_seed(seed);
+    Log("[PASS]test_random\n");
+}
+
+/*
+ * Test Case: A layout file loads into the same airport as one add_* call per resource, and a
+ * bad file or shard is refused before anything is added
+ */
+void test_sim_layout() {
+    const string path = "/tmp/airport_test_layout.txt";
+    {
+        ofstream out(path, ios::binary);
+        out << "# two runways, one on each shard\r\nrunway r_0\r\n\n  runway\tr_1 1   # on shard 1\n";
+        for (int i = 0; i < 6; ++i) {
+            out << "stand p_" << i << (i == 5 ? " 0" : "") << '\n';
+        }
+        out << "stand p_last";                  // no newline at the end
+    }
+    Layout layout = read_layout(path);
+    assert(layout.runways.size() == 2 && layout.parking_stands.size() == 7);
+    assert(layout.runways.id(1) == "r_1" && layout.runways.shard(1) == 1 && layout.runways.shard(0) == kAnyShard);
+    assert(layout.parking_stands.id(6) == "p_last" && layout.parking_stands.shard(5) == 0);
+    write_layout(path, layout);
+    Layout again = read_layout(path);
+    assert(again.parking_stands.size() == 7 && again.parking_stands.id(6) == "p_last");
+    assert(again.runways.shard(1) == 1);
+
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    Airport loaded {engine}, added {engine};
+    loaded.set_shards(2);
+    added.set_shards(2);
+    loaded.load_layout(path);
+    added.add_runway(make_shared<Runway>(0));
+    added.add_runway(make_shared<Runway>(1), 1);
+    for (int i = 0; i < 6; ++i) {
+        if (i == 5) {
+            added.add_parking_stands(make_shared<ParkingStand>(i), 0);
+        }
+        else {
+            added.add_parking_stands(make_shared<ParkingStand>(i));
+        }
+    }
+    added.add_parking_stands(make_shared<ParkingStand>("p_last"));
+    assert(loaded.find_runway("r_1") == 1 && loaded.find_parking_stand("p_last") == 6);
+    assert(loaded.runway(1)->getRunway_id() == "r_1" && loaded.parking_stand(6)->getState() == ParkingStandState::Available);
+    for (int i = 0; i < 3; ++i) {
+        LandingRequestToken a = loaded.request_landing("Aircraft " + to_string(i));
+        LandingRequestToken b = added.request_landing("Aircraft " + to_string(i));
+        assert(a.state == b.state && a.runway == b.runway && a.parking_stand == b.parking_stand);
+        if (a.state == AirportState::Proceed) {
+            assert(loaded.perform_landing(a) && added.perform_landing(b));
+        }
+    }
+    engine->run();
+
+    // Resources loaded on top of others, then added one by one after.
+    Layout more;
+    more.parking_stands.add("p_more");
+    loaded.load_layout(more);
+    loaded.add_parking_stands(make_shared<ParkingStand>("p_after"));
+    assert(loaded.find_parking_stand("p_more") == 7 && loaded.find_parking_stand("p_after") == 8);
+    assert(loaded.find_parking_stand("p_0") == 0);
+
+    string msg = "";
+    try {
+        Layout bad;
+        bad.runways.add("r_9", 2);
+        loaded.load_layout(bad);
+    }
+    catch (runtime_error& e) {
+        msg.append(static_cast<string>(e.what()));
+    }
+    assert(msg == "This airport does not have this shard");
+    assert(loaded.find_runway("r_9") == kInvalidHandle);
+    const char *errors[][2] = {
+        {"runway r_0\ngate g_0\n", "Layout line 2: unknown resource kind"},
+        {"stand   # nothing\n", "Layout line 1: missing id"},
+        {"stand p_0 x\n", "Layout line 1: bad shard"},
+        {"stand p_0 1 2\n", "Layout line 1: unexpected text after the shard"},
+    };
+    for (auto &error : errors) {
+        msg = "";
+        try {
+            parse_layout(error[0], strlen(error[0]));
+        }
+        catch (runtime_error& e) {
+            msg.append(static_cast<string>(e.what()));
+        }
+        assert(msg == error[1]);
+    }
+    remove(path.c_str());
+    Log("[PASS]test_sim_layout\n");
+}
+
+/*
+ * Test Case: Hold clients queue up and are granted in arrival order as resources free up
+ */
+void test_sim_wait_queue() {
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    Airport airport {engine};
+    airport.add_runway(make_shared<Runway>(0));
+    airport.add_parking_stands(make_shared<ParkingStand>(0));
+    airport.add_parking_stands(make_shared<ParkingStand>(1));
+
+    vector<string> granted;
+    auto land = [&airport, &granted](LandingRequestToken token) {
+        assert(token.state == AirportState::Proceed);
+        granted.push_back(airport.aircraft_of(token));
+        airport.perform_landing(token);
+    };
+    airport.request_landing_async("Aircraft 0", land);      // free now, granted inline
+    assert(granted.size() == 1);
+    airport.request_landing_async("Aircraft 1", land);
+    airport.request_landing_async("Aircraft 2", land);
+    assert(airport.waiters() == 2);
+    engine->run();
+    assert(granted.size() == 2 && granted[1] == "Aircraft 1");  // no stand left for Aircraft 2
+    assert(airport.waiters() == 1);
+
+    TakeOffRequestToken token;
+    airport.request_takeoff_async("Aircraft 0", [&token](TakeOffRequestToken t) { token = t; });
+    assert(token.state == AirportState::Proceed);
+    airport.perform_takeoff(token);
+    engine->run();                                  // the freed stand goes straight to Aircraft 2
+    assert(granted.size() == 3 && granted[2] == "Aircraft 2");
+    assert(airport.waiters() == 0);
+    Log("[PASS]test_sim_wait_queue\n");
+}
+
+void test_wait_queue_future(vector<string> planes) {
+    Airport airport {};
+    airport.add_runway(make_shared<Runway>(0));
+    airport.add_parking_stands(make_shared<ParkingStand>(0));
+    airport.add_parking_stands(make_shared<ParkingStand>(1));
+
+    future<LandingRequestToken> first = airport.request_landing_async(planes.at(0));
+    future<LandingRequestToken> second = airport.request_landing_async(planes.at(1));
+    assert(first.wait_for(seconds(0)) == future_status::ready);
+    airport.perform_landing(first.get());
+    assert(second.wait_for(seconds(1)) == future_status::timeout);
+    LandingRequestToken token = second.get();       // granted when the runway frees up
+    assert(token.state == AirportState::Proceed && airport.aircraft_of(token) == planes.at(1));
+    Log("[PASS]test_wait_queue_future\n");
+}
+
+/*
+ * Test Case: an Emergency takes over a Reserved landing, and is granted ahead of earlier routine waiters
+ */
+void test_sim_priority() {
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    Airport airport {engine};
+    airport.add_runway(make_shared<Runway>(0));
+    for (int i = 0; i < 3; ++i) {
+        airport.add_parking_stands(make_shared<ParkingStand>(i));
+    }
+
+    LandingRequestToken routine = airport.request_landing("Aircraft 0");
+    assert(airport.request_landing("Aircraft 1", LandingPriority::Priority).state == AirportState::Hold);
+    LandingRequestToken emergency = airport.request_landing("Aircraft 2", LandingPriority::Emergency);
+    assert(emergency.state == AirportState::Proceed && airport.preemptions() == 1);
+    assert(emergency.runway == routine.runway && emergency.parking_stand == routine.parking_stand);
+    string msg = "";
+    try {
+        airport.perform_landing(routine);
+    }
+    catch (runtime_error& e) {
+        msg.append(static_cast<string>(e.what()));
+    }
+    assert(msg == "Runway is not reserved");
+    airport.perform_landing(emergency);
+    assert(airport.request_landing("Aircraft 3", LandingPriority::Emergency).state == AirportState::Hold);
+
+    vector<string> granted;
+    auto land = [&airport, &granted](LandingRequestToken token) {
+        granted.push_back(airport.aircraft_of(token));
+        airport.perform_landing(token);
+    };
+    airport.request_landing_async("Aircraft 4", land);
+    airport.request_landing_async("Aircraft 5", land, LandingPriority::Priority);
+    airport.request_landing_async("Aircraft 6", land, LandingPriority::Emergency);
+    engine->run();
+    assert(granted.size() == 2 && granted[0] == "Aircraft 6" && granted[1] == "Aircraft 5");
+    assert(airport.waiters() == 1);                 // no stand left for the routine one
+    GrantLatency latency = airport.landing_latency(LandingPriority::Emergency);
+    assert(latency.grants == 1 && latency.max == seconds(kOperationDurationSec));
+    assert(airport.landing_latency(LandingPriority::Priority).max == seconds(2 * kOperationDurationSec));
+    assert(airport.landing_latency(LandingPriority::Routine).grants == 0);
+    Log("[PASS]test_sim_priority\n");
+}
+
+void test_stats() {
+    LatencyHistogram histogram;
+    for (uint64_t ns = 1; ns <= 100000; ++ns) {
+        histogram.record(ns);
+    }
+    assert(histogram.count() == 100000 && histogram.max() == 100000);
+    uint64_t p50 = histogram.percentile(0.5);
+    assert(p50 >= 50000 && p50 <= 50000 * 9 / 8);    // within one bucket
+    for (int b = 1; b < LatencyHistogram::kBuckets; ++b) {
+        assert(LatencyHistogram::bucket_of(LatencyHistogram::bucket_high(b)) == b);
+        assert(LatencyHistogram::bucket_of(LatencyHistogram::bucket_high(b - 1) + 1) == b);
+    }
+
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    Airport airport {engine};
+    shared_ptr<ParkingStand> ps = make_shared<ParkingStand>(0);
+    airport.add_runway(make_shared<Runway>(0));
+    airport.add_parking_stands(ps);
+    ps->setState(ParkingStandState::Occupied);      // still in the free index
+    assert(airport.request_landing("Aircraft 0").state == AirportState::Hold);
+    ps->setState(ParkingStandState::Available);
+
+    vector<thread> clients;
+    for (int i = 0; i < 4; ++i) {
+        clients.emplace_back([&airport]() {
+            for (int j = 0; j < 100; ++j) {
+                airport.request_landing("Aircraft 1");      // the stand left the free index
+            }
+        });
+    }
+    for (auto &client : clients) {
+        client.join();
+    }
+    AirportStats stats = airport.stats();
+    assert(stats.request_landing.count() == 401);   // every thread's shard is merged
+    assert(stats.parking_stand_reserve_failures.size() == 1 && stats.parking_stand_reserve_failures[0] == 1);
+    assert(stats.runway_reserve_failures[0] == 0);
+
+    Airport other {engine};
+    other.add_runway(make_shared<Runway>(0));
+    other.add_parking_stands(make_shared<ParkingStand>(0));
+    other.add_parking_stands(make_shared<ParkingStand>(1));
+    other.perform_landing(other.request_landing("Aircraft 0"));
+    auto land = [&other](LandingRequestToken token) { other.perform_landing(token); };
+    other.request_landing_async("Aircraft 1", land);
+    engine->run();
+    stats = other.stats();
+    assert(stats.hold_wait.count() == 1 && stats.hold_wait.max() ==
+           static_cast<uint64_t>(nanoseconds(seconds(kOperationDurationSec)).count()));
+    assert(stats.perform_landing.count() == 2);
+    Log("[PASS]test_stats\n");
+}
+
+void test_trace() {
+    const uint32_t kMarker = 0xA1F;
+    thread([kMarker]() {
+        for (uint32_t i = 0; i < kTraceRingSize + 10; ++i) {
+            trace_record(TraceEvent::Reserve, TracePhase::Instant, kMarker, 0, i);
+        }
+    }).join();
+    thread([kMarker]() {
+        TraceScope scope(TraceEvent::ExpireTokens, kMarker);    // takes over the exited thread's ring
+    }).join();
+
+    const string path = "airport_trace_test.bin";
+    assert(trace_dump(path));
+    TraceFile file;
+    assert(trace_load(path, file));
+    remove(path.c_str());
+    assert(file.ns_per_tick > 0);
+    const TraceThread *ring = nullptr, *scope = nullptr;
+    for (auto &thread : file.threads) {
+        const TraceRecord &first = thread.records.front();
+        if (first.a == kMarker && first.event == TraceEvent::Reserve) {
+            ring = &thread;
+        }
+        if (first.a == kMarker && first.event == TraceEvent::ExpireTokens) {
+            scope = &thread;
+        }
+    }
+    assert(ring && scope && ring->tid != scope->tid);
+    assert(ring->records.size() == kTraceRingSize - 2);     // the scope overwrote the two oldest
+    for (size_t i = 0; i < ring->records.size(); ++i) {
+        assert(ring->records[i].c == i + 12);
+    }
+    assert(scope->records.size() == 2 && scope->records[0].phase == TracePhase::Begin &&
+           scope->records[1].phase == TracePhase::End && scope->records[0].ticks <= scope->records[1].ticks);
+
+    ostringstream json;
+    write_chrome_trace(file, json);
+    assert(json.str().find("{\"name\": \"expire_tokens\", \"cat\": \"airport\", \"ph\": \"B\"") != string::npos);
+    assert(json.str().find("\"args\": {\"runway\": 2591, \"stand\": 0, \"epoch\": 16393}") != string::npos);
+    Log("[PASS]test_trace\n");
+}
+
+/** Logs a const array that lives on this call's stack only. */
+static void log_local_label(int i) {
+    const char label[] = {'<', 'l', static_cast<char>('0' + i), '>', '\n', '\0'};
+    Log(label);
+}
+
+void test_logger() {
+    ostringstream captured;
+    Logger &logger = Logger::instance();
+    logger.set_output(captured);
+
+    const int kMessages = 3 * kLogRingSize;         // more than a buffer holds
+    vector<thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([t, kMessages]() {
+            for (int i = 0; i < kMessages; ++i) {
+                Log('<', t, ':', i, ">\n");
+            }
+        });
+    }
+    for (auto &writer : writers) {
+        writer.join();
+    }
+    char buffer[] = "copied";
+    const char *pointer = buffer;
+    Log(pointer, '\n');
+    buffer[0] = 'X';                                // the message already holds its own copy
+    log_local_label(1);                             // the second call reuses the first one's stack
+    log_local_label(2);
+    string big(200, 'b');
+    Log(big, big, big, '\n');                      // too big for an entry, formatted right away
+    logger.flush();
+
+    string text = captured.str();
+    for (int t = 0; t < 4; ++t) {
+        size_t at = 0;
+        for (int i = 0; i < kMessages; ++i) {       // each thread's messages in order
+            at = text.find("<" + to_string(t) + ":" + to_string(i) + ">\n", at);
+            assert(at != string::npos);
+        }
+    }
+    assert(text.find("copied\n") != string::npos);
+    assert(text.find("<l1>\n") != string::npos && text.find("<l2>\n") != string::npos);
+    assert(text.find(big + big + big + "\n") != string::npos);
+
+    shared_ptr<SimEngine> engine = make_shared<SimEngine>();
+    {
+        Airport airport {engine};
+        airport.set_movement_log(true);
+        airport.add_runway(make_shared<Runway>(0));
+        airport.add_parking_stands(make_shared<ParkingStand>(0));
+        airport.perform_landing(airport.request_landing("Aircraft 0"));
+        engine->run();
+        airport.perform_takeoff(airport.request_takeoff("Aircraft 0"));
+        engine->run();
+    }
+    logger.flush();
+    text = captured.str();
+    size_t landed = text.find("Aircraft ID: Aircraft 0, Parking ID: ");
+    assert(landed != string::npos && text.find(", took off\n", landed) != string::npos);
+
+    shared_ptr<Logger> owner = Logger::shared();
+    long owners = owner.use_count();
+    thread owning([owners]() {
+        Log("<owner>\n");
+        assert(Logger::shared().use_count() > owners);     // owned by the thread's buffer
+    });
+    owning.join();
+    assert(owner.use_count() <= owners);                    // and given up when it exits
+    assert(logger.dropped() == 0);
+    logger.set_output(cout);
+    Log("[PASS]test_logger\n");
+}
+
+void test_timing_wheel() {
+    TimingWheel<int> wheel;
+    vector<int> due;
+    wheel.advance(1000, due);                       // idle wheel jumps straight there
+    assert(wheel.current() == 1000);
+    const uint64_t deadlines[] = {1001, 1255, 1256, 1300, 70000, 1000 + (1u << 24), 999};
+    for (int i = 0; i < 7; ++i) {
+        wheel.insert(deadlines[i], i);
+    }
+    assert(wheel.next_due() == 1001);
+    wheel.advance(1001, due);
+    assert(due.size() == 2);                        // 1001, and 999 which was already late
+    for (int i = 1; i < 6; ++i) {
+        due.clear();
+        assert(wheel.next_due() <= deadlines[i]);       // never sleeps past a deadline
+        wheel.advance(deadlines[i] - 1, due);
+        assert(due.empty());
+        wheel.advance(deadlines[i], due);
+        assert(due.size() == 1 && due[0] == i);
+    }
+    assert(wheel.size() == 0 && wheel.next_due() == UINT64_MAX);
+    Log("[PASS]test_timing_wheel\n");
+}
+
 void test_request_landing_race1(int t) {
     Airport airport{};
     vector<shared_ptr<thread>> aircrafts;
@@ -322,6 +1686,148 @@ void test_request_landing_race1(int t) {
     Log("[PASS]test_request_landing_race1: ", t, '\n');
 }
 
+/*
+ * Test Case: Emergencies preempt routine reservations while they are being made. Every token's
+ * aircraft is its own or none, and every landing that started parks its own aircraft.
+ */
+void test_preempt_race(int t) {
+    const int routine_threads = 3, rounds = 200;
+    Airport airport{};
+    airport.set_operation_duration(microseconds(20));
+    for (int i = 0; i < 4; ++i) {
+        airport.add_runway(make_shared<Runway>(i));
+    }
+    for (int i = 0; i < (routine_threads + 1) * rounds; ++i) {
+        airport.add_parking_stands(make_shared<ParkingStand>(i));
+    }
+    mutex landed_lock;
+    vector<string> landed;
+    atomic<int> preempted_performs {0};
+    auto fly = [&airport, &landed_lock, &landed, &preempted_performs](const string &prefix, LandingPriority priority) {
+        for (int i = 0; i < rounds; ++i) {
+            string id = prefix + to_string(i);
+            LandingRequestToken token = airport.request_landing(id, priority);
+            while (token.state != AirportState::Proceed) {
+                this_thread::yield();
+                token = airport.request_landing(id, priority);
+            }
+            string holder = airport.aircraft_of(token);
+            assert(holder == id || holder.empty());
+            if (priority == LandingPriority::Routine) {
+                this_thread::sleep_for(microseconds(50));   // an open reservation for the Emergency to take
+            }
+            try {
+                airport.perform_landing(token);
+                lock_guard<mutex> guard(landed_lock);
+                landed.push_back(id);
+            }
+            catch (runtime_error &e) {
+                assert(static_cast<string>(e.what()) == "Runway is not reserved");
+                ++preempted_performs;
+            }
+        }
+    };
+    vector<thread> threads;
+    for (int r = 0; r < routine_threads; ++r) {
+        threads.emplace_back([&fly, r]() { fly("Routine " + to_string(r) + " ", LandingPriority::Routine); });
+    }
+    threads.emplace_back([&fly]() { fly("Emergency ", LandingPriority::Emergency); });
+    for (auto &aircraft : threads) {
+        aircraft.join();
+    }
+    airport.wait_idle();
+    assert(static_cast<uint64_t>(preempted_performs.load()) <= airport.preemptions());
+    for (auto &id : landed) {
+        // Throws if the aircraft is not parked, e.g. if another's landing parked its id.
+        TakeOffRequestToken token = airport.request_takeoff(id);
+        while (token.state != AirportState::Proceed) {
+            this_thread::yield();
+            token = airport.request_takeoff(id);
+        }
+        assert(airport.aircraft_of(token) == id);
+        airport.perform_takeoff(token);
+    }
+    airport.wait_idle();
+    Log("[PASS]test_preempt_race: ", t, ", ", landed.size(), " landed, ", airport.preemptions(), " preempted\n");
+}
+
+void test_expiry_race(int t) {
+    // Tokens are never performed, so every grant after the first few waits for an expiry tick
+    // that reclaims reservations staged by several threads at once.
+    const int threads = 4, grants = 100, pairs = 8;
+    Airport airport{};
+    airport.set_token_validity(microseconds(200));
+    for (int i = 0; i < pairs; ++i) {
+        airport.add_runway(make_shared<Runway>(i));
+        airport.add_parking_stands(make_shared<ParkingStand>(i));
+    }
+    vector<thread> aircraft;
+    for (int i = 0; i < threads; ++i) {
+        aircraft.emplace_back([&airport, i]() {
+            string id = "Aircraft " + to_string(i);
+            for (int g = 0; g < grants; ++g) {
+                while (airport.request_landing(id).state != AirportState::Proceed) {
+                    this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &a : aircraft) {
+        a.join();
+    }
+    this_thread::sleep_for(milliseconds(20));
+    vector<string> ids(pairs, "Late");
+    vector<LandingRequestToken> tokens = airport.request_landing_batch(ids);
+    for (auto &token : tokens) {
+        assert(token.state == AirportState::Proceed);    // nothing staged was lost
+    }
+    Log("[PASS]test_expiry_race: ", t, '\n');
+}
+
+void test_wait_queue_race(int t) {
+    // Async requests from several threads at once, each granted one performs its landing, so
+    // the runways keep handing waiters over while more arrive.
+    const int threads = 4, requests = 50;
+    Airport airport{};
+    airport.set_operation_duration(microseconds(20));
+    for (int i = 0; i < 2; ++i) {
+        airport.add_runway(make_shared<Runway>(i));
+    }
+    for (int i = 0; i < threads * requests; ++i) {
+        airport.add_parking_stands(make_shared<ParkingStand>(i));
+    }
+    atomic<int> landed {0};
+    vector<thread> clients;
+    for (int i = 0; i < threads; ++i) {
+        clients.emplace_back([&airport, &landed, i]() {
+            for (int r = 0; r < requests; ++r) {
+                string id = "Aircraft " + to_string(i) + " " + to_string(r);
+                LandingPriority priority = r % 2 ? LandingPriority::Priority : LandingPriority::Routine;   // nothing preempts
+                airport.request_landing_async(id, [&airport, &landed, id](LandingRequestToken token) {
+                    assert(token.state == AirportState::Proceed && airport.aircraft_of(token) == id);
+                    airport.perform_landing(token);
+                    ++landed;
+                }, priority);
+            }
+        });
+    }
+    for (auto &client : clients) {
+        client.join();
+    }
+    for (int i = 0; i < 10000 && landed.load() < threads * requests; ++i) {
+        this_thread::sleep_for(milliseconds(1));
+    }
+    airport.wait_idle();
+    assert(landed.load() == threads * requests && airport.waiters() == 0);
+    for (int i = 0; i < threads; ++i) {
+        for (int r = 0; r < requests; ++r) {
+            // Throws if the aircraft is not parked.
+            airport.request_takeoff("Aircraft " + to_string(i) + " " + to_string(r));
+        }
+    }
+    Log("[PASS]test_wait_queue_race: ", t, '\n');
+}
+
 void test_request_landing_race2(int t) {
     // check deadlock & livelock
     Airport airport{};
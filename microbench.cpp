@@ -0,0 +1,211 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+
+#include "airport.h"
+#include "timer_service.h"
+
+using namespace std;
+using namespace std::chrono;
+
+/**
+ * Micro-benchmarks for the Airport hot paths, printed as one JSON document on stdout.
+ * Operations take no time and complete inside perform_*, so every number is the cost of the
+ * call itself. Each latency sample includes one steady_clock read.
+ */
+
+/** Runs zero-delay work (completions) inline and hands anything later (expiry ticks) to a timer. */
+class InlineScheduler : public Scheduler {
+private:
+    TimerService timer;
+
+public:
+    InlineScheduler() : timer(1) {}
+
+    nanoseconds now() override {
+        return timer.now();
+    }
+
+    void schedule_after(nanoseconds delay, function<void()> fn) override {
+        if (delay <= nanoseconds::zero()) {
+            fn();
+            return;
+        }
+        timer.schedule_after(delay, fn);
+    }
+};
+
+enum Op { kRequestLanding, kPerformLanding, kRequestTakeoff, kPerformTakeoff, kReserve, kOps };
+static const char *kOpNames[kOps] = {"request_landing", "perform_landing", "request_takeoff", "perform_takeoff",
+                                     "reserve_landing_resource"};
+
+typedef vector<vector<uint64_t>> Samples;      // per Op, nanoseconds
+
+template<typename F>
+static inline void timed(vector<uint64_t> &samples, F f) {
+    auto start = steady_clock::now();
+    f();
+    samples.push_back(static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now() - start).count()));
+}
+
+/** Land and take off `cycles` times. Hold answers are retried and counted like any request. */
+static void airport_cycles(Airport &airport, int t, int cycles, Samples &samples) {
+    string id = "Aircraft " + to_string(t);
+    for (int c = 0; c < cycles; ++c) {
+        LandingRequestToken landing;
+        for (;;) {
+            timed(samples[kRequestLanding], [&]() { landing = airport.request_landing(id); });
+            if (landing.state == AirportState::Proceed) {
+                break;
+            }
+            this_thread::yield();
+        }
+        timed(samples[kPerformLanding], [&]() { airport.perform_landing(landing); });
+
+        TakeOffRequestToken takeoff;
+        for (;;) {
+            timed(samples[kRequestTakeoff], [&]() { takeoff = airport.request_takeoff(id); });
+            if (takeoff.state == AirportState::Proceed) {
+                break;
+            }
+            this_thread::yield();
+        }
+        timed(samples[kPerformTakeoff], [&]() { airport.perform_takeoff(takeoff); });
+    }
+}
+
+/** The two CASes of Airport::reserve_landing_resource on shared cells, rolled back untimed. */
+static void reserve_cycles(ResourceStore &store, int t, int cycles, Samples &samples) {
+    size_t num_rw = store.runway_count();
+    size_t num_ps = store.parking_stand_count();
+    for (int c = 0; c < cycles; ++c) {
+        ResourceHandle rw_idx = static_cast<ResourceHandle>((t + c) % num_rw);
+        ResourceHandle ps_idx = static_cast<ResourceHandle>((t + c) % num_ps);
+        uint32_t epoch;
+        bool runway = false, stand = false;
+        timed(samples[kReserve], [&]() {
+            runway = Runway::reserve(store.runway_state(rw_idx), epoch);
+            stand = runway && ParkingStand::transition(store.parking_stand_state(ps_idx),
+                                                       ParkingStandState::Available, ParkingStandState::Reserved);
+        });
+        if (stand) {
+            ParkingStand::transition(store.parking_stand_state(ps_idx), ParkingStandState::Reserved,
+                                     ParkingStandState::Available);
+        }
+        if (runway) {
+            Runway::transition(store.runway_state(rw_idx), epoch, RunwayState::Reserved, RunwayState::Available);
+        }
+    }
+}
+
+static uint64_t percentile(const vector<uint64_t> &sorted, double q) {
+    size_t i = static_cast<size_t>(q * sorted.size());
+    return sorted[min(i, sorted.size() - 1)];
+}
+
+/** One JSON object per op. ops_per_sec is that op's count over the run's wall time, so in the
+ * land/take-off cycle the four calls share the same clock. */
+static void report(const Samples &merged, double wall_sec, int threads, int shards, int num_rw, int num_ps,
+                   bool &first) {
+    for (int op = 0; op < kOps; ++op) {
+        vector<uint64_t> sorted = merged[op];
+        if (sorted.empty()) {
+            continue;
+        }
+        sort(sorted.begin(), sorted.end());
+        double ops_per_sec = sorted.size() / wall_sec;
+        cout << (first ? "\n" : ",\n") << "    {\"op\": \"" << kOpNames[op] << "\", \"threads\": " << threads
+             << ", \"shards\": " << shards << ", \"runways\": " << num_rw << ", \"stands\": " << num_ps << ", \"ops\": " << sorted.size()
+             << ", \"ops_per_sec\": " << static_cast<uint64_t>(ops_per_sec)
+             << ", \"p50_ns\": " << percentile(sorted, 0.5) << ", \"p99_ns\": " << percentile(sorted, 0.99)
+             << ", \"p999_ns\": " << percentile(sorted, 0.999) << "}";
+        first = false;
+    }
+}
+
+template<typename Setup, typename Body>
+static Samples run_threads(int threads, Setup setup, Body body, double &wall_sec) {
+    auto shared = setup();
+    vector<Samples> per_thread(threads, Samples(kOps));
+    vector<thread> workers;
+    auto start = steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() { body(*shared, t, per_thread[t]); });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+    wall_sec = duration<double>(steady_clock::now() - start).count();
+    Samples merged(kOps);
+    for (auto &samples : per_thread) {
+        for (int op = 0; op < kOps; ++op) {
+            merged[op].insert(merged[op].end(), samples[op].begin(), samples[op].end());
+        }
+    }
+    return merged;
+}
+
+/*
+ * Usage: AirportMicrobench [cycles]  (land + take-off cycles per configuration, default 20000)
+ * The airport cycle runs with one shard and, with several threads, with one shard per thread.
+ */
+int main(int argc, char **argv) {
+    int cycles = argc > 1 ? atoi(argv[1]) : 20000;
+    const int thread_counts[] = {1, 2, 4, 8};
+    const int runway_counts[] = {1, 4, 16};
+    const int stand_counts[] = {16, 1024};
+
+    bool first = true;
+    cout << "{\"benchmarks\": [";
+    for (int threads : thread_counts) {
+        for (int num_rw : runway_counts) {
+            for (int num_ps : stand_counts) {
+                int per_thread = max(1, cycles / threads);
+                double wall_sec;
+                vector<int> shard_counts = threads == 1 ? vector<int>{1} : vector<int>{1, threads};
+                for (int shards : shard_counts) {
+                    Samples airport = run_threads(threads, [&]() {
+                        shared_ptr<Airport> a = make_shared<Airport>(make_shared<InlineScheduler>());
+                        a->set_operation_duration(nanoseconds::zero());
+                        a->set_shards(static_cast<unsigned>(shards));
+                        for (int i = 0; i < num_rw; ++i) {
+                            a->add_runway(make_shared<Runway>(i));
+                        }
+                        for (int i = 0; i < num_ps; ++i) {
+                            a->add_parking_stands(make_shared<ParkingStand>(i));
+                        }
+                        return a;
+                    }, [per_thread](Airport &a, int t, Samples &samples) {
+                        airport_cycles(a, t, per_thread, samples);
+                    }, wall_sec);
+                    report(airport, wall_sec, threads, shards, num_rw, num_ps, first);
+                }
+
+                Samples reserve = run_threads(threads, [&]() {
+                    shared_ptr<ResourceStore> store = make_shared<ResourceStore>();
+                    for (int i = 0; i < num_rw; ++i) {
+                        store->add_runway("r_" + to_string(i), Runway::pack(0, RunwayState::Available));
+                    }
+                    for (int i = 0; i < num_ps; ++i) {
+                        store->add_parking_stand("p_" + to_string(i),
+                                                 static_cast<uint8_t>(ParkingStandState::Available));
+                    }
+                    return store;
+                }, [per_thread](ResourceStore &store, int t, Samples &samples) {
+                    reserve_cycles(store, t, 4 * per_thread, samples);
+                }, wall_sec);
+                report(reserve, wall_sec, threads, 1, num_rw, num_ps, first);
+            }
+        }
+    }
+    cout << "\n]}\n";
+    return 0;
+}
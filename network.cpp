@@ -0,0 +1,286 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <stdexcept>
+#include <string>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+#include "network.h"
+
+static const uint32_t kBatchMagic = 0x41464c54;     // "AFLT"
+
+/** Sent ahead of every batch. */
+struct BatchHeader {
+    uint32_t magic;
+    uint32_t count;
+    uint64_t window;
+};
+
+static void fail(const char *what) {
+    throw std::runtime_error(std::string(what) + ": " + strerror(errno));
+}
+
+/*
+ * Blocks until fd is ready for events.
+ */
+static void wait_for(int fd, short events) {
+    pollfd pfd = {fd, events, 0};
+    while (poll(&pfd, 1, -1) < 0) {
+        if (errno != EINTR) {
+            fail("poll");
+        }
+    }
+}
+
+/*
+ * @return : bytes written, 0 if the socket buffer is full
+ */
+static size_t write_some(int fd, iovec *iov, int count) {
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    for (;;) {
+        ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (n >= 0) {
+            return static_cast<size_t>(n);
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        }
+        if (errno != EINTR) {
+            fail("send");
+        }
+    }
+}
+
+/*
+ * @return : bytes read, 0 if nothing was there yet
+ */
+static size_t read_some(int fd, void *data, size_t size) {
+    for (;;) {
+        ssize_t n = read(fd, data, size);
+        if (n > 0) {
+            return static_cast<size_t>(n);
+        }
+        if (n == 0) {
+            throw std::runtime_error("Peer node closed the connection");
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        }
+        if (errno != EINTR) {
+            fail("read");
+        }
+    }
+}
+
+NodeMesh::NodeMesh(unsigned node, std::vector<int> fds) : node(node), fds(std::move(fds)) {
+    for (int fd : this->fds) {
+        if (fd >= 0 && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+            fail("fcntl");
+        }
+    }
+}
+
+NodeMesh::~NodeMesh() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    for (int pid : children) {
+        int status;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    }
+}
+
+NodeMesh *NodeMesh::spawn(unsigned nodes) {
+    // ends[i][j]: node i's socket to node j
+    std::vector<std::vector<int>> ends(nodes, std::vector<int>(nodes, -1));
+    for (unsigned i = 0; i < nodes; ++i) {
+        for (unsigned j = i + 1; j < nodes; ++j) {
+            int sv[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+                fail("socketpair");
+            }
+            ends[i][j] = sv[0];
+            ends[j][i] = sv[1];
+        }
+    }
+    std::cout.flush();      // or the children print the parent's buffered output again
+    std::vector<int> children;
+    unsigned self = 0;
+    for (unsigned i = 1; i < nodes && self == 0; ++i) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            fail("fork");
+        }
+        if (pid == 0) {
+            self = i;
+            children.clear();
+        }
+        else {
+            children.push_back(pid);
+        }
+    }
+    for (unsigned i = 0; i < nodes; ++i) {
+        for (unsigned j = 0; j < nodes; ++j) {
+            if (i != self && ends[i][j] >= 0) {
+                close(ends[i][j]);
+            }
+        }
+    }
+    NodeMesh *mesh = new NodeMesh(self, ends[self]);
+    mesh->children = children;
+    return mesh;
+}
+
+void NodeMesh::send_all(unsigned peer, const void *data, size_t size) {
+    const char *p = static_cast<const char *>(data);
+    while (size) {
+        iovec iov = {const_cast<char *>(p), size};
+        size_t n = write_some(fds[peer], &iov, 1);
+        if (!n) {
+            wait_for(fds[peer], POLLOUT);
+        }
+        p += n;
+        size -= n;
+    }
+}
+
+void NodeMesh::recv_all(unsigned peer, void *data, size_t size) {
+    char *p = static_cast<char *>(data);
+    while (size) {
+        size_t n = read_some(fds[peer], p, size);
+        if (!n) {
+            wait_for(fds[peer], POLLIN);
+        }
+        p += n;
+        size -= n;
+    }
+}
+
+/*
+ * One poll loop over every peer: write whatever the socket takes, read whatever has arrived,
+ * until every batch is out and every peer's batch is in.
+ */
+void NodeMesh::exchange(uint64_t window, std::vector<std::vector<FlightMessage>> &outgoing,
+                        std::vector<FlightMessage> &incoming, NodeStats &stats) {
+    struct Peer {
+        BatchHeader out_header;
+        size_t sent = 0;                // bytes of header and flights
+        BatchHeader in_header;
+        size_t received = 0;            // bytes of header and flights
+        size_t base = 0;                // where its flights go in incoming
+    };
+    unsigned count = nodes();
+    std::vector<Peer> peers(count);
+    for (unsigned i = 0; i < count; ++i) {
+        if (i != node) {
+            peers[i].out_header = {kBatchMagic, static_cast<uint32_t>(outgoing[i].size()), window};
+        }
+    }
+
+    std::vector<pollfd> pfds;
+    std::vector<unsigned> polled;
+    for (;;) {
+        pfds.clear();
+        polled.clear();
+        for (unsigned i = 0; i < count; ++i) {
+            if (i == node) {
+                continue;
+            }
+            Peer &peer = peers[i];
+            short events = 0;
+            if (peer.sent < sizeof(BatchHeader) + outgoing[i].size() * sizeof(FlightMessage)) {
+                events |= POLLOUT;
+            }
+            if (peer.received < sizeof(BatchHeader) ||
+                peer.received < sizeof(BatchHeader) + peer.in_header.count * sizeof(FlightMessage)) {
+                events |= POLLIN;
+            }
+            if (events) {
+                pfds.push_back({fds[i], events, 0});
+                polled.push_back(i);
+            }
+        }
+        if (pfds.empty()) {
+            break;
+        }
+        if (poll(pfds.data(), pfds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fail("poll");
+        }
+        for (size_t k = 0; k < pfds.size(); ++k) {
+            unsigned i = polled[k];
+            Peer &peer = peers[i];
+            if (pfds[k].revents & POLLOUT) {
+                iovec iov[2];
+                int n = 0;
+                if (peer.sent < sizeof(BatchHeader)) {
+                    iov[n++] = {reinterpret_cast<char *>(&peer.out_header) + peer.sent, sizeof(BatchHeader) - peer.sent};
+                    iov[n++] = {outgoing[i].data(), outgoing[i].size() * sizeof(FlightMessage)};
+                }
+                else {
+                    size_t done = peer.sent - sizeof(BatchHeader);
+                    iov[n++] = {reinterpret_cast<char *>(outgoing[i].data()) + done,
+                                outgoing[i].size() * sizeof(FlightMessage) - done};
+                }
+                peer.sent += write_some(fds[i], iov, n);
+            }
+            if (pfds[k].revents & (POLLIN | POLLHUP | POLLERR)) {
+                if (peer.received < sizeof(BatchHeader)) {
+                    peer.received += read_some(fds[i], reinterpret_cast<char *>(&peer.in_header) + peer.received,
+                                               sizeof(BatchHeader) - peer.received);
+                    if (peer.received == sizeof(BatchHeader)) {
+                        if (peer.in_header.magic != kBatchMagic || peer.in_header.window != window) {
+                            throw std::runtime_error("Peer node is out of step");
+                        }
+                        peer.base = incoming.size();
+                        incoming.resize(peer.base + peer.in_header.count);
+                    }
+                }
+                else {
+                    size_t done = peer.received - sizeof(BatchHeader);
+                    peer.received += read_some(fds[i], reinterpret_cast<char *>(incoming.data() + peer.base) + done,
+                                               peer.in_header.count * sizeof(FlightMessage) - done);
+                }
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < count; ++i) {
+        if (i != node) {
+            ++stats.batches;
+            stats.bytes += peers[i].sent;
+            outgoing[i].clear();
+        }
+    }
+}
+
+std::vector<NodeStats> NodeMesh::gather(const NodeStats &stats) {
+    std::vector<NodeStats> all;
+    if (node != 0) {
+        send_all(0, &stats, sizeof(stats));
+        return all;
+    }
+    all.resize(nodes());
+    all[0] = stats;
+    for (unsigned i = 1; i < nodes(); ++i) {
+        recv_all(i, &all[i], sizeof(NodeStats));
+    }
+    return all;
+}
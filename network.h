@@ -0,0 +1,91 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#ifndef AIRPORTSIMULATOR_NETWORK_H
+#define AIRPORTSIMULATOR_NETWORK_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <type_traits>
+
+/** A flight on its way to an airport hosted by another node. Sent as it is, in host byte
+ * order, so every node must run on the same host. */
+struct FlightMessage {
+    uint64_t aircraft;
+    int64_t arrival;            // sim nanoseconds at which the aircraft asks to land
+    uint32_t destination;       // airport, numbered across the whole network
+    uint32_t origin;
+};
+
+static_assert(std::is_trivially_copyable<FlightMessage>::value, "flight messages are sent as raw bytes");
+static_assert(sizeof(FlightMessage) == 24, "flight messages are sent as raw bytes");
+
+/** Traffic counters of one node, gathered on node 0 at the end of a run. */
+struct NodeStats {
+    uint64_t movements = 0;         // landings and take-offs performed
+    uint64_t local_flights = 0;     // flights between two airports of the node
+    uint64_t remote_flights = 0;    // flights sent to another node
+    uint64_t batches = 0;           // batches sent, one per peer per window
+    uint64_t bytes = 0;             // bytes sent
+    uint64_t events = 0;            // sim engine events processed
+    double wall_sec = 0;            // whole run
+    double sync_sec = 0;            // spent in exchange(), sending and waiting for peers
+};
+
+/** Full mesh of Unix-domain stream sockets between the processes of one network run, one per
+ * pair of nodes. Nodes advance in lock-step windows of simulated time: after running a window
+ * every node sends each peer one batch with the flights it started towards that peer's
+ * airports, possibly none, and waits for a batch from every peer before running the next
+ * window. As long as no flight is shorter than a window, every arrival reaches its node before
+ * the window it lands in starts. */
+class NodeMesh {
+private:
+    unsigned node;
+    std::vector<int> fds;           // per peer; -1 for this node
+    std::vector<int> children;      // pids forked by spawn(), waited for on destruction
+
+    void send_all(unsigned peer, const void *data, size_t size);
+    void recv_all(unsigned peer, void *data, size_t size);
+
+public:
+    /*
+     * Takes over the sockets to every other node.
+     * @param node: this node
+     * @param fds: socket to each node, by node, -1 for this node
+     */
+    NodeMesh(unsigned node, std::vector<int> fds);
+    /** Closes the sockets; on the node that spawned the others, waits for them to exit. */
+    ~NodeMesh();
+    NodeMesh(const NodeMesh &) = delete;
+    NodeMesh &operator=(const NodeMesh &) = delete;
+
+    /*
+     * Connects nodes processes with socketpairs and forks nodes - 1 children, which return
+     * here as well. Call before starting any thread.
+     * @return : the mesh of the calling process; its node_id() is 0 in the parent
+     */
+    static NodeMesh *spawn(unsigned nodes);
+
+    unsigned node_id() const { return node; }
+    unsigned nodes() const { return static_cast<unsigned>(fds.size()); }
+
+    /*
+     * Sends outgoing[peer] to every peer and collects what every peer sent for the same window,
+     * appending it to incoming. Sends and receives are interleaved, so batches bigger than the
+     * socket buffers cannot deadlock two nodes writing to each other.
+     * @param window: sequence number, checked against the peers'
+     * @param outgoing: flights per node; cleared once sent
+     * @param stats: batches and bytes are added here
+     */
+    void exchange(uint64_t window, std::vector<std::vector<FlightMessage>> &outgoing,
+                  std::vector<FlightMessage> &incoming, NodeStats &stats);
+
+    /*
+     * Sends stats to node 0, which returns every node's, by node. Other nodes get an empty vector.
+     */
+    std::vector<NodeStats> gather(const NodeStats &stats);
+};
+
+#endif //AIRPORTSIMULATOR_NETWORK_H
@@ -0,0 +1,275 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "airport.h"
+#include "sim_engine.h"
+#include "network.h"
+#include "random.h"
+
+using namespace std;
+using namespace std::chrono;
+
+/**
+ * Regional network of airports spread over several processes on one host. Airport a is hosted by
+ * node a % nodes, each node running its airports on its own SimEngine. Aircraft fly between
+ * random airports: a take-off becomes a landing request at the destination after the flight
+ * time, sent to the destination's node in that window's batch if it lives elsewhere.
+ *
+ * Nodes run windows of sim time in lock-step, exchanging one batch per peer after each window.
+ * A window is at most the shortest flight plus the runway occupancy, so every flight reaches its
+ * node before it is due; shorter windows only add exchanges.
+ *
+ * Usage: AirportNetwork [--nodes n] [--airports n] [--aircraft per airport] [--runways n]
+ *                       [--stands n] [--hours h] [--op-s s] [--turnaround-min m]
+ *                       [--flight-min m] [--flight-max m] [--window-s s] [--seed n]
+ */
+
+struct NetworkConfig {
+    unsigned nodes = 4;
+    unsigned airports = 30;
+    unsigned aircraft = 100;        // based at each airport at the start
+    int runways = 2;
+    int stands = 256;
+    double hours = 24;
+    double op_s = 120;              // runway occupancy of one landing or take-off
+    double turnaround_min = 45;     // mean time on the stand; half fixed, half exponential
+    double flight_min = 30;
+    double flight_max = 180;
+    double window_s = 0;            // 0: as long as the lookahead allows
+    uint64_t seed = 42;
+
+    nanoseconds op() const { return duration_cast<nanoseconds>(duration<double>(op_s)); }
+    nanoseconds lookahead() const { return op() + duration_cast<nanoseconds>(duration<double>(flight_min * 60)); }
+
+    nanoseconds window() const {
+        nanoseconds window = duration_cast<nanoseconds>(duration<double>(window_s));
+        return window > nanoseconds::zero() ? min(window, lookahead()) : lookahead();
+    }
+};
+
+class NetworkNode {
+private:
+    const NetworkConfig &config;
+    NodeMesh &mesh;
+    shared_ptr<SimEngine> engine;
+    vector<unique_ptr<Airport>> airports;       // by local index, after the engine so they go first
+    Xoshiro256 rng;
+    vector<vector<FlightMessage>> outgoing;     // per node
+    vector<FlightMessage> incoming;
+    NodeStats stats;
+    bool stopping = false;                      // past the end: no new movements
+
+    unsigned node_of(uint32_t airport) const { return airport % mesh.nodes(); }
+    Airport &local(uint32_t airport) { return *airports[airport / mesh.nodes()]; }
+
+    static string aircraft_name(uint64_t aircraft) {
+        return "Aircraft " + to_string(aircraft);
+    }
+
+    nanoseconds turnaround() {
+        double minutes = config.turnaround_min / 2 + exponential(rng, config.turnaround_min / 2);
+        return duration_cast<nanoseconds>(duration<double>(minutes * 60));
+    }
+
+    double flight_minutes() {
+        return config.flight_min + rng.uniform() * max(config.flight_max - config.flight_min, 0.0);
+    }
+
+    void arrive(uint32_t airport, uint64_t aircraft) {
+        if (stopping) {
+            return;
+        }
+        local(airport).request_landing_async(aircraft_name(aircraft), [this, airport, aircraft](LandingRequestToken token) {
+            local(airport).perform_landing(token);
+            ++stats.movements;
+            engine->schedule_after(config.op() + turnaround(), [this, airport, aircraft]() { depart(airport, aircraft); });
+        });
+    }
+
+    void depart(uint32_t airport, uint64_t aircraft) {
+        if (stopping) {
+            return;
+        }
+        local(airport).request_takeoff_async(aircraft_name(aircraft), [this, airport, aircraft](TakeOffRequestToken token) {
+            local(airport).perform_takeoff(token);
+            ++stats.movements;
+            uint32_t to = static_cast<uint32_t>(rng.below(config.airports - 1));
+            to += to >= airport;        // anywhere but here
+            nanoseconds arrival = engine->now() + config.op() +
+                                  duration_cast<nanoseconds>(duration<double>(flight_minutes() * 60));
+            if (node_of(to) == mesh.node_id()) {
+                ++stats.local_flights;
+                engine->schedule_at(arrival, [this, to, aircraft]() { arrive(to, aircraft); });
+            }
+            else {
+                ++stats.remote_flights;
+                outgoing[node_of(to)].push_back({aircraft, arrival.count(), to, airport});
+            }
+        });
+    }
+
+public:
+    NetworkNode(const NetworkConfig &config, NodeMesh &mesh) :
+            config(config), mesh(mesh), engine(make_shared<SimEngine>()), rng(config.seed, mesh.node_id()),
+            outgoing(mesh.nodes()) {
+        for (uint32_t a = mesh.node_id(); a < config.airports; a += mesh.nodes()) {
+            unique_ptr<Airport> airport(new Airport(engine));
+            airport->set_operation_duration(config.op());
+            for (int i = 0; i < config.runways; ++i) {
+                airport->add_runway(make_shared<Runway>(i));
+            }
+            for (int i = 0; i < config.stands; ++i) {
+                airport->add_parking_stands(make_shared<ParkingStand>(i));
+            }
+            airports.push_back(move(airport));
+        }
+    }
+
+    ~NetworkNode() {
+        stopping = true;
+        engine->run();      // let the movements in flight complete before the airports go
+    }
+
+    /*
+     * Based aircraft arrive at their home airport over the first turnaround, then the windows run.
+     */
+    NodeStats run() {
+        steady_clock::time_point start = steady_clock::now();
+        for (uint32_t a = mesh.node_id(); a < config.airports; a += mesh.nodes()) {
+            for (uint64_t i = 0; i < config.aircraft; ++i) {
+                uint64_t aircraft = uint64_t(a) * config.aircraft + i;
+                double minutes = rng.uniform() * config.turnaround_min;
+                nanoseconds at = duration_cast<nanoseconds>(duration<double>(minutes * 60));
+                engine->schedule_at(at, [this, a, aircraft]() { arrive(a, aircraft); });
+            }
+        }
+
+        nanoseconds end = duration_cast<nanoseconds>(duration<double>(config.hours * 3600));
+        nanoseconds window = config.window();
+        for (uint64_t w = 0; nanoseconds(w * window.count()) < end; ++w) {
+            engine->run_until(min(end, nanoseconds((w + 1) * window.count())));
+            steady_clock::time_point sync = steady_clock::now();
+            mesh.exchange(w, outgoing, incoming, stats);
+            // Peers answer in any order; sorted, a run does not depend on it.
+            sort(incoming.begin(), incoming.end(), [](const FlightMessage &x, const FlightMessage &y) {
+                return x.arrival != y.arrival ? x.arrival < y.arrival : x.aircraft < y.aircraft;
+            });
+            for (auto &flight : incoming) {
+                uint32_t to = flight.destination;
+                uint64_t aircraft = flight.aircraft;
+                engine->schedule_at(nanoseconds(flight.arrival), [this, to, aircraft]() { arrive(to, aircraft); });
+            }
+            incoming.clear();
+            stats.sync_sec += duration<double>(steady_clock::now() - sync).count();
+        }
+        stats.events = engine->events_processed();
+        stats.wall_sec = duration<double>(steady_clock::now() - start).count();
+        return stats;
+    }
+};
+
+static void report(const NetworkConfig &config, const vector<NodeStats> &nodes) {
+    NodeStats total;
+    for (auto &node : nodes) {
+        total.movements += node.movements;
+        total.local_flights += node.local_flights;
+        total.remote_flights += node.remote_flights;
+        total.batches += node.batches;
+        total.bytes += node.bytes;
+        total.events += node.events;
+        total.wall_sec = max(total.wall_sec, node.wall_sec);
+    }
+    double window_s = duration<double>(config.window()).count();
+    cout << fixed << setprecision(1) << config.nodes << " nodes, " << config.airports << " airports, "
+         << config.airports * config.aircraft << " aircraft, " << config.hours << " sim hours in windows of "
+         << window_s << "s\n\n"
+         << setw(6) << "node" << setw(12) << "movements" << setw(10) << "local" << setw(10) << "remote"
+         << setw(10) << "batches" << setw(12) << "events" << setw(10) << "sync s" << setw(10) << "wall s" << '\n';
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const NodeStats &node = nodes[i];
+        cout << setw(6) << i << setw(12) << node.movements << setw(10) << node.local_flights << setw(10)
+             << node.remote_flights << setw(10) << node.batches << setw(12) << node.events << setprecision(2)
+             << setw(10) << node.sync_sec << setw(10) << node.wall_sec << setprecision(1) << '\n';
+    }
+    double wall = max(total.wall_sec, 1e-9);
+    cout << "\n" << total.movements << " movements, " << total.remote_flights << " flights between nodes in "
+         << total.batches << " batches (" << total.bytes / 1024 << " KiB) in " << setprecision(2) << wall
+         << "s wall\n" << setprecision(0) << total.remote_flights / wall << " messages/s, " << total.movements / wall
+         << " movements/s, " << setprecision(1) << config.hours / (wall / 3600) << "x real time\n";
+}
+
+int main(int argc, char **argv) {
+    NetworkConfig config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char *key = argv[i];
+        const char *value = argv[i + 1];
+        if (!strcmp(key, "--nodes")) {
+            config.nodes = static_cast<unsigned>(max(1, atoi(value)));
+        }
+        else if (!strcmp(key, "--airports")) {
+            config.airports = static_cast<unsigned>(max(2, atoi(value)));
+        }
+        else if (!strcmp(key, "--aircraft")) {
+            config.aircraft = static_cast<unsigned>(max(0, atoi(value)));
+        }
+        else if (!strcmp(key, "--runways")) {
+            config.runways = atoi(value);
+        }
+        else if (!strcmp(key, "--stands")) {
+            config.stands = atoi(value);
+        }
+        else if (!strcmp(key, "--hours")) {
+            config.hours = atof(value);
+        }
+        else if (!strcmp(key, "--op-s")) {
+            config.op_s = atof(value);
+        }
+        else if (!strcmp(key, "--turnaround-min")) {
+            config.turnaround_min = atof(value);
+        }
+        else if (!strcmp(key, "--flight-min")) {
+            config.flight_min = atof(value);
+        }
+        else if (!strcmp(key, "--flight-max")) {
+            config.flight_max = atof(value);
+        }
+        else if (!strcmp(key, "--window-s")) {
+            config.window_s = atof(value);
+        }
+        else if (!strcmp(key, "--seed")) {
+            config.seed = strtoull(value, nullptr, 10);
+        }
+        else {
+            cerr << "unknown option " << key << '\n';
+            return 1;
+        }
+    }
+    if (config.window() <= nanoseconds::zero()) {
+        cerr << "flights and runway occupancy must take some time\n";
+        return 1;
+    }
+    config.nodes = min(config.nodes, config.airports);
+
+    unique_ptr<NodeMesh> mesh(NodeMesh::spawn(config.nodes));
+    NodeStats stats;
+    {
+        NetworkNode node(config, *mesh);
+        stats = node.run();
+    }
+    vector<NodeStats> all = mesh->gather(stats);
+    if (mesh->node_id() == 0) {
+        report(config, all);
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <cstring>
+#include <cstdint>
+
+#include "parking_registry.h"
+
+/*
+ * Picks the shard from the first and last 8 bytes of the id. The shard's own map hashes the
+ * whole string again, so this only has to spread ids over 64 shards, and it has to be cheap.
+ */
+ParkingRegistry::Shard &ParkingRegistry::shard_for(const std::string &aircraft_id) {
+    uint64_t head = 0, tail = 0;
+    size_t n = aircraft_id.size();
+    std::memcpy(&head, aircraft_id.data(), n < 8 ? n : 8);
+    std::memcpy(&tail, aircraft_id.data() + (n < 8 ? 0 : n - 8), n < 8 ? n : 8);
+    uint64_t mix = (head * 0x9E3779B97F4A7C15ull) ^ (tail * 0xC2B2AE3D27D4EB4Full) ^ n;
+    return shards[(mix >> 40) % kShards];
+}
+
+void ParkingRegistry::insert(const std::string &aircraft_id, ResourceHandle parking_stand) {
+    Shard &shard = shard_for(aircraft_id);
+    std::lock_guard<std::mutex> guard(shard.s_lock);
+    shard.stands[aircraft_id] = parking_stand;
+}
+
+bool ParkingRegistry::find(const std::string &aircraft_id, ResourceHandle &parking_stand) {
+    Shard &shard = shard_for(aircraft_id);
+    std::lock_guard<std::mutex> guard(shard.s_lock);
+    auto got = shard.stands.find(aircraft_id);
+    if (got == shard.stands.end()) {
+        return false;
+    }
+    parking_stand = got->second;
+    return true;
+}
+
+bool ParkingRegistry::erase(const std::string &aircraft_id) {
+    Shard &shard = shard_for(aircraft_id);
+    std::lock_guard<std::mutex> guard(shard.s_lock);
+    return shard.stands.erase(aircraft_id) > 0;
+}
+
+size_t ParkingRegistry::size() {
+    size_t total = 0;
+    for (auto &shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.s_lock);
+        total += shard.stands.size();
+    }
+    return total;
+}
+
+void ParkingRegistry::reserve(size_t count) {
+    for (auto &shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.s_lock);
+        shard.stands.reserve(count / kShards + 1);
+    }
+}
+
+void ParkingRegistry::for_each(const std::function<void(const std::string &, ResourceHandle)> &fn) {
+    for (auto &shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.s_lock);
+        for (auto &entry : shard.stands) {
+            fn(entry.first, entry.second);
+        }
+    }
+}
@@ -0,0 +1,43 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#ifndef AIRPORTSIMULATOR_PARKING_REGISTRY_H
+#define AIRPORTSIMULATOR_PARKING_REGISTRY_H
+
+#include <string>
+#include <mutex>
+#include <unordered_map>
+#include <functional>
+
+#include "tokens.h"
+
+/** Which parking stand each landed aircraft is on. The map is split into shards with their own
+ * lock, so lookups and updates for different aircraft rarely meet on the same mutex. */
+class ParkingRegistry {
+private:
+    static constexpr size_t kShards = 64;
+
+    struct Shard {
+        std::mutex s_lock;
+        std::unordered_map<std::string, ResourceHandle> stands;     // key: aircraft_id
+        char pad[64];       // keeps neighbouring shards off each other's cache lines
+    };
+
+    Shard shards[kShards];
+
+    Shard &shard_for(const std::string &aircraft_id);
+
+public:
+    void insert(const std::string &aircraft_id, ResourceHandle parking_stand);
+    /** Returns false if the aircraft is not parked here. */
+    bool find(const std::string &aircraft_id, ResourceHandle &parking_stand);
+    bool erase(const std::string &aircraft_id);
+    size_t size();
+    /** Sizes the shards for about count aircraft. */
+    void reserve(size_t count);
+    /** Calls fn(aircraft_id, parking_stand) for every parked aircraft, one shard locked at a time. */
+    void for_each(const std::function<void(const std::string &, ResourceHandle)> &fn);
+};
+
+#endif //AIRPORTSIMULATOR_PARKING_REGISTRY_H
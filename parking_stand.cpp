@@ -3,12 +3,26 @@
 //
 
 #include "parking_stand.h"
+#include "resource_store.h"
 
-ParkingStand::ParkingStand() {
-    state = ParkingStandState::Available;
+ParkingStand::ParkingStand() : index(0) {
+    local_state = static_cast<uint8_t>(ParkingStandState::Available);
 }
 
-ParkingStand::ParkingStand(int id) {
+ParkingStand::ParkingStand(int id) : index(0) {
     parking_id = "p_" + std::to_string(id);
-    state = ParkingStandState::Available;
+    local_state = static_cast<uint8_t>(ParkingStandState::Available);
+}
+
+ParkingStand::ParkingStand(const std::string &id) : parking_id(id), index(0) {
+    local_state = static_cast<uint8_t>(ParkingStandState::Available);
+}
+
+std::atomic<uint8_t> &ParkingStand::cell() const {
+    return store ? store->parking_stand_state(index) : local_state;
+}
+
+void ParkingStand::attach(std::shared_ptr<ResourceStore> store, uint32_t index) {
+    ParkingStand::store = store;
+    ParkingStand::index = index;
 }
@@ -6,24 +6,44 @@
 #define AIRPORTSIMULATOR_PARKING_STAND_H
 
 #include <string>
-#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
 
 enum class ParkingStandState { Occupied, Reserved, Available };
 
-/** Parking stand. Useful whether you're in a 747-800 or a station wagon. */
+class ResourceStore;
+
+/** Parking stand. Useful whether you're in a 747-800 or a station wagon.
+ * Once added to an airport it is a view of that airport's ResourceStore. */
 class ParkingStand {
 private:
     std::string parking_id;
-    ParkingStandState state;
+    mutable std::atomic<uint8_t> local_state;
+    std::shared_ptr<ResourceStore> store;           // set once the stand joins an airport
+    uint32_t index;
+
+    std::atomic<uint8_t> &cell() const;
 
 public:
-    std::mutex p_lock;
     ParkingStand();
     ParkingStand(int id);
+    explicit ParkingStand(const std::string &id);
 
-    ParkingStandState getState() const { return state; }
-    void setState(ParkingStandState state) { ParkingStand::state = state; }
+    static bool transition(std::atomic<uint8_t> &cell, ParkingStandState from, ParkingStandState to) {
+        uint8_t expected = static_cast<uint8_t>(from);
+        return cell.compare_exchange_strong(expected, static_cast<uint8_t>(to));
+    }
+
+    ParkingStandState getState() const { return static_cast<ParkingStandState>(cell().load()); }
+    void setState(ParkingStandState state) { cell() = static_cast<uint8_t>(state); }
+    /** Compare-and-swap from `from` to `to`. Fails if the state was not `from`. */
+    bool transition(ParkingStandState from, ParkingStandState to) { return transition(cell(), from, to); }
     const std::string &getParking_id() const { return parking_id; }
+
+    /** Moves the stand's state into slot `index` of `store`. Done by Airport::add_parking_stands. */
+    void attach(std::shared_ptr<ResourceStore> store, uint32_t index);
+    bool attached() const { return store != nullptr; }
 };
 
 #endif //AIRPORTSIMULATOR_PARKING_STAND_H
@@ -0,0 +1,367 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <cmath>
+#include <cstring>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+
+#include "random.h"
+
+static const double kTwoPi = 6.283185307179586;
+
+/** Automatic thread streams count from here, clear of the numbers set_thread_stream() is given. */
+static const uint64_t kAutoStreams = uint64_t(1) << 63;
+
+static inline uint64_t splitmix64(uint64_t &x) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+Xoshiro256::Xoshiro256(uint64_t seed, uint64_t stream) {
+    uint64_t key = seed;
+    uint64_t x = splitmix64(key) ^ stream;
+    for (auto &word : s) {
+        word = splitmix64(x);
+    }
+    if (!(s[0] | s[1] | s[2] | s[3])) {
+        s[0] = 1;                           // the one state xoshiro cannot leave
+    }
+}
+
+uint64_t Xoshiro256::below(uint64_t n) {
+    if (n == 0) {
+        return 0;
+    }
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 m = static_cast<unsigned __int128>((*this)()) * n;
+    uint64_t low = static_cast<uint64_t>(m);
+    if (low < n) {
+        uint64_t threshold = (0 - n) % n;
+        while (low < threshold) {
+            m = static_cast<unsigned __int128>((*this)()) * n;
+            low = static_cast<uint64_t>(m);
+        }
+    }
+    return static_cast<uint64_t>(m >> 64);
+#else
+    uint64_t threshold = (0 - n) % n;
+    uint64_t x;
+    do {
+        x = (*this)();
+    } while (x < threshold);
+    return x % n;
+#endif
+}
+
+void Xoshiro256::jump() {
+    static const uint64_t kJump[4] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL,
+                                      0x39abdc4529b1661cULL};
+    uint64_t t[4] = {0, 0, 0, 0};
+    for (uint64_t word : kJump) {
+        for (int b = 0; b < 64; ++b) {
+            if (word & (uint64_t(1) << b)) {
+                for (int i = 0; i < 4; ++i) {
+                    t[i] ^= s[i];
+                }
+            }
+            (*this)();
+        }
+    }
+    memcpy(s, t, sizeof(s));
+}
+
+RandomBulk::RandomBulk(uint64_t seed, uint64_t stream) {
+    Xoshiro256 lane(seed, stream);
+    for (int l = 0; l < kRandomLanes; ++l) {
+        for (int w = 0; w < 4; ++w) {
+            s[w][l] = lane.s[w];
+        }
+        lane.jump();
+    }
+}
+
+/** A row of lanes, in the GCC and Clang vector extensions: operators apply lane by lane, and a
+ * cast between rows of the same size keeps the bits. */
+typedef uint64_t LaneWords __attribute__((vector_size(sizeof(uint64_t) * kRandomLanes)));
+typedef double LaneDoubles __attribute__((vector_size(sizeof(double) * kRandomLanes)));
+
+static inline void rotl_lanes(LaneWords &x, int k) {
+    x = (x << k) | (x >> (64 - k));
+}
+
+/*
+ * One draw of every lane. The multiplications by 5 and 9 are shifts and adds: SSE2 and AVX2 have
+ * no 64-bit lane multiply. Rows go by reference throughout: passing a 32-byte vector by value
+ * depends on whether AVX is enabled.
+ */
+static inline void step(LaneWords state[4], LaneWords &result) {
+    LaneWords rotated = (state[1] << 2) + state[1];
+    rotl_lanes(rotated, 7);
+    result = (rotated << 3) + rotated;
+    LaneWords t = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    rotl_lanes(state[3], 45);
+}
+
+/*
+ * The top 52 bits under the exponent of 1.0 give a double in [1, 2) without an integer to float
+ * conversion, which has no vector form before AVX-512.
+ */
+static inline void to_uniform(const LaneWords &bits, LaneDoubles &u) {
+    LaneWords one_to_two = (bits >> 12) | 0x3FF0000000000000ULL;
+    u = (LaneDoubles) one_to_two - 1.0;
+}
+
+/*
+ * Runs rows draws of the lanes held in s, handing each row to emit. The state stays in registers
+ * for the whole fill.
+ */
+template<typename Emit>
+static void draw_rows(uint64_t s[4][kRandomLanes], size_t rows, Emit emit) {
+    LaneWords state[4];
+    memcpy(state, s, sizeof(state));
+    LaneWords words;
+    for (size_t row = 0; row < rows; ++row) {
+        step(state, words);
+        emit(row, words);
+    }
+    memcpy(s, state, sizeof(state));
+}
+
+/*
+ * Draws whole rows: a fill that is not a multiple of kRandomLanes drops the rest of its last
+ * row, so splitting a fill differently changes what follows.
+ */
+void RandomBulk::fill(uint64_t *out, size_t n) {
+    size_t whole = n / kRandomLanes;
+    draw_rows(s, whole, [out] (size_t row, const LaneWords &words) {
+        memcpy(out + row * kRandomLanes, &words, sizeof(words));
+    });
+    if (whole * kRandomLanes < n) {
+        LaneWords last;
+        draw_rows(s, 1, [&last] (size_t, const LaneWords &words) { last = words; });
+        memcpy(out + whole * kRandomLanes, &last, (n - whole * kRandomLanes) * sizeof(uint64_t));
+    }
+}
+
+void RandomBulk::fill_uniform(double *out, size_t n) {
+    size_t whole = n / kRandomLanes;
+    draw_rows(s, whole, [out] (size_t row, const LaneWords &words) {
+        LaneDoubles u;
+        to_uniform(words, u);
+        memcpy(out + row * kRandomLanes, &u, sizeof(u));
+    });
+    if (whole * kRandomLanes < n) {
+        LaneDoubles last;
+        draw_rows(s, 1, [&last] (size_t, const LaneWords &words) { to_uniform(words, last); });
+        memcpy(out + whole * kRandomLanes, &last, (n - whole * kRandomLanes) * sizeof(double));
+    }
+}
+
+void RandomBulk::fill_exponential(double *out, size_t n, double mean) {
+    fill_uniform(out, n);
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = -mean * std::log(1.0 - out[i]);
+    }
+}
+
+/*
+ * Box-Muller, both draws of each pair used.
+ */
+void RandomBulk::fill_normal(double *out, size_t n, double mean, double stddev) {
+    size_t even = n & ~size_t(1);
+    fill_uniform(out, even);
+    for (size_t i = 0; i < even; i += 2) {
+        double r = stddev * std::sqrt(-2.0 * std::log(1.0 - out[i]));
+        double theta = kTwoPi * out[i + 1];
+        out[i] = mean + r * std::cos(theta);
+        out[i + 1] = mean + r * std::sin(theta);
+    }
+    if (even < n) {
+        double pair[2];
+        fill_uniform(pair, 2);
+        out[even] = mean + stddev * std::sqrt(-2.0 * std::log(1.0 - pair[0])) * std::cos(kTwoPi * pair[1]);
+    }
+}
+
+void RandomBulk::fill_lognormal(double *out, size_t n, double mu, double sigma) {
+    fill_normal(out, n, mu, sigma);
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = std::exp(out[i]);
+    }
+}
+
+double exponential(Xoshiro256 &rng, double mean) {
+    return -mean * std::log(1.0 - rng.uniform());
+}
+
+double normal(Xoshiro256 &rng, double mean, double stddev) {
+    double u1 = rng.uniform();
+    double u2 = rng.uniform();
+    return mean + stddev * std::sqrt(-2.0 * std::log(1.0 - u1)) * std::cos(kTwoPi * u2);
+}
+
+double lognormal(Xoshiro256 &rng, double mu, double sigma) {
+    return std::exp(normal(rng, mu, sigma));
+}
+
+/*
+ * Below 10, multiplies uniforms until they drop under e^-mean. From 10 on the multiplications
+ * would grow with the mean, so PTRS (Hörmann 1993) draws a candidate from a transformed
+ * uniform and mostly accepts it without evaluating the density.
+ */
+uint64_t poisson(Xoshiro256 &rng, double mean) {
+    if (mean <= 0) {
+        return 0;
+    }
+    if (mean < 10) {
+        double limit = std::exp(-mean);
+        double product = rng.uniform();
+        uint64_t k = 0;
+        while (product > limit) {
+            ++k;
+            product *= rng.uniform();
+        }
+        return k;
+    }
+    double slam = std::sqrt(mean);
+    double loglam = std::log(mean);
+    double b = 0.931 + 2.53 * slam;
+    double a = -0.059 + 0.02483 * b;
+    double invalpha = 1.1239 + 1.1328 / (b - 3.4);
+    double vr = 0.9277 - 3.6224 / (b - 2);
+    for (;;) {
+        double u = rng.uniform() - 0.5;
+        double v = rng.uniform();
+        double us = 0.5 - std::fabs(u);
+        double k = std::floor((2 * a / us + b) * u + mean + 0.43);
+        if (us >= 0.07 && v <= vr) {
+            return static_cast<uint64_t>(k);
+        }
+        if (k < 0 || (us < 0.013 && v > us)) {
+            continue;
+        }
+        if (std::log(v) + std::log(invalpha) - std::log(a / (us * us) + b) <=
+            -mean + k * loglam - std::lgamma(k + 1)) {
+            return static_cast<uint64_t>(k);
+        }
+    }
+}
+
+/*
+ * Vose's construction: slots below the average are topped up from one above it, which then
+ * goes back on the list it now belongs to.
+ */
+DiscreteSampler::DiscreteSampler(const std::vector<double> &weights) :
+        accept(weights.size(), 1.0), alias(weights.size()) {
+    double sum = 0;
+    for (double w : weights) {
+        if (!(w >= 0)) {
+            throw std::runtime_error("Weights must not be negative");
+        }
+        sum += w;
+    }
+    if (weights.empty() || !(sum > 0)) {
+        throw std::runtime_error("Weights must not all be zero");
+    }
+    size_t n = weights.size();
+    std::vector<double> scaled(n);
+    std::vector<uint32_t> small, large;
+    for (size_t i = 0; i < n; ++i) {
+        scaled[i] = weights[i] * n / sum;
+        alias[i] = static_cast<uint32_t>(i);
+        (scaled[i] < 1 ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+    while (!small.empty() && !large.empty()) {
+        uint32_t less = small.back();
+        uint32_t more = large.back();
+        small.pop_back();
+        large.pop_back();
+        accept[less] = scaled[less];
+        alias[less] = more;
+        scaled[more] += scaled[less] - 1;
+        (scaled[more] < 1 ? small : large).push_back(more);
+    }
+    // Whatever is left is 1 up to rounding and keeps its own slot.
+}
+
+/*
+ * One uniform picks the slot with its integer part and decides on the alias with the rest.
+ */
+uint32_t DiscreteSampler::operator()(Xoshiro256 &rng) const {
+    double x = rng.uniform() * accept.size();
+    uint32_t slot = std::min(static_cast<uint32_t>(x), static_cast<uint32_t>(accept.size() - 1));
+    return x - slot < accept[slot] ? slot : alias[slot];
+}
+
+void DiscreteSampler::fill(RandomBulk &rng, uint32_t *out, size_t n) const {
+    double u[256];
+    for (size_t done = 0; done < n; done += 256) {
+        size_t count = std::min(n - done, size_t(256));
+        rng.fill_uniform(u, count);
+        for (size_t i = 0; i < count; ++i) {
+            double x = u[i] * accept.size();
+            uint32_t slot = std::min(static_cast<uint32_t>(x), static_cast<uint32_t>(accept.size() - 1));
+            out[done + i] = x - slot < accept[slot] ? slot : alias[slot];
+        }
+    }
+}
+
+/** A thread's generator and the seed generation it was seeded for. */
+struct ThreadRandom {
+    uint64_t generation = UINT64_MAX;
+    uint64_t stream = 0;
+    bool assigned = false;
+    Xoshiro256 rng;
+};
+
+static std::atomic<uint64_t> master_seed {kDefaultRandomSeed};
+static std::atomic<uint64_t> seed_generation {0};
+static std::atomic<uint64_t> next_stream {0};
+
+static ThreadRandom &thread_state() {
+    static thread_local ThreadRandom state;
+    return state;
+}
+
+void set_random_seed(uint64_t seed) {
+    master_seed = seed;
+    ++seed_generation;
+}
+
+uint64_t random_seed() {
+    return master_seed.load();
+}
+
+void set_thread_stream(uint64_t stream) {
+    ThreadRandom &state = thread_state();
+    state.stream = stream;
+    state.assigned = true;
+    state.generation = UINT64_MAX;
+}
+
+/*
+ * One atomic load on every call after the first, to notice a new master seed.
+ */
+Xoshiro256 &thread_random() {
+    ThreadRandom &state = thread_state();
+    uint64_t generation = seed_generation.load(std::memory_order_acquire);
+    if (state.generation != generation) {
+        if (!state.assigned) {
+            state.stream = kAutoStreams + next_stream++;
+            state.assigned = true;
+        }
+        state.rng = Xoshiro256(master_seed.load(), state.stream);
+        state.generation = generation;
+    }
+    return state.rng;
+}
@@ -0,0 +1,140 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#ifndef AIRPORTSIMULATOR_RANDOM_H
+#define AIRPORTSIMULATOR_RANDOM_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/** Master seed of thread_random() until set_random_seed() is called. */
+static constexpr uint64_t kDefaultRandomSeed = 42;
+
+/** Lanes a RandomBulk steps together; four 64-bit words fill one AVX2 register. */
+static constexpr int kRandomLanes = 4;
+
+static inline uint64_t rotl64(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/** xoshiro256** (Blackman and Vigna): 256 bits of state, period 2^256 - 1, a few shifts, adds
+ * and rotations per draw and no lock. Every stream is a pure function of its seed and stream
+ * number, so a run draws the same numbers on every machine and standard library. Usable with
+ * the <random> distributions, but the samplers below are what keeps runs reproducible, since
+ * those distributions differ between standard libraries. Not thread-safe: one per thread. */
+class Xoshiro256 {
+private:
+    uint64_t s[4];
+
+    friend class RandomBulk;
+
+public:
+    typedef uint64_t result_type;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    /** Stream number stream of seed. The state is seed and stream run through splitmix64, so
+     * streams of one seed do not overlap in practice; jump() gives provably disjoint ones. */
+    explicit Xoshiro256(uint64_t seed = kDefaultRandomSeed, uint64_t stream = 0);
+
+    uint64_t operator()() {
+        uint64_t result = rotl64(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl64(s[3], 45);
+        return result;
+    }
+
+    /** [0, 1) in steps of 2^-53. */
+    double uniform() {
+        return static_cast<double>((*this)() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /*
+     * Unbiased, by Lemire's multiply-and-reject: one multiply, and a division only in the rare
+     * case a draw may have to be rejected.
+     * @return : [0, n), 0 if n is 0
+     */
+    uint64_t below(uint64_t n);
+
+    /*
+     * @return : [low, high], both included
+     */
+    int64_t between(int64_t low, int64_t high) {
+        return low + static_cast<int64_t>(below(static_cast<uint64_t>(high - low) + 1));
+    }
+
+    /** Advances the stream by 2^128 draws, e.g. to split it into non-overlapping parts. */
+    void jump();
+};
+
+/** kRandomLanes xoshiro256** streams stepped together for bulk draws. The state is stored word
+ * by lane, so each step is the same few operations on a row of lanes, done as vector
+ * instructions (SSE2 pairs, one AVX2 register where enabled). The output interleaves the lanes:
+ * it is reproducible, but not the sequence a single Xoshiro256 of the same seed draws. Not
+ * thread-safe: one per thread. */
+class RandomBulk {
+private:
+    alignas(32) uint64_t s[4][kRandomLanes];
+
+public:
+    /** Lane i is Xoshiro256(seed, stream) jumped i times. */
+    explicit RandomBulk(uint64_t seed = kDefaultRandomSeed, uint64_t stream = 0);
+
+    void fill(uint64_t *out, size_t n);
+    /** [0, 1) in steps of 2^-52, one bit coarser than Xoshiro256::uniform(). */
+    void fill_uniform(double *out, size_t n);
+    void fill_exponential(double *out, size_t n, double mean);
+    void fill_normal(double *out, size_t n, double mean, double stddev);
+    /** exp of a normal(mu, sigma). */
+    void fill_lognormal(double *out, size_t n, double mu, double sigma);
+};
+
+/*
+ * Samplers. Written out here rather than taken from <random>, whose distributions may draw a
+ * different number of times or round differently from one standard library to the next.
+ */
+
+/** Inversion: -mean * log(1 - u). */
+double exponential(Xoshiro256 &rng, double mean);
+/** Box-Muller, one draw of the pair; two uniforms per sample. */
+double normal(Xoshiro256 &rng, double mean, double stddev);
+double lognormal(Xoshiro256 &rng, double mu, double sigma);
+/** Multiplication for small means, Hörmann's PTRS transformed rejection from 10 on. */
+uint64_t poisson(Xoshiro256 &rng, double mean);
+
+/** Picks index i with probability weights[i] / sum in O(1), from Walker/Vose alias tables. */
+class DiscreteSampler {
+private:
+    std::vector<double> accept;         // per slot, chance to keep the slot itself
+    std::vector<uint32_t> alias;        // per slot, the index taken otherwise
+
+public:
+    /** Throws if weights is empty, negative anywhere or all zero. */
+    explicit DiscreteSampler(const std::vector<double> &weights);
+
+    uint32_t operator()(Xoshiro256 &rng) const;
+    void fill(RandomBulk &rng, uint32_t *out, size_t n) const;
+    size_t size() const { return accept.size(); }
+};
+
+/** Master seed of the per-thread streams. A thread's stream is re-seeded on its next draw, so
+ * set it before the threads start drawing, e.g. first thing in main(). */
+void set_random_seed(uint64_t seed);
+uint64_t random_seed();
+
+/** Makes the calling thread draw stream number stream of the master seed from now on. Threads
+ * that do not pick one get the next unused number on their first draw, in the order they draw;
+ * pick one when that order is not fixed, e.g. the worker's index. */
+void set_thread_stream(uint64_t stream);
+
+/** The calling thread's generator, see set_thread_stream(). */
+Xoshiro256 &thread_random();
+
+#endif //AIRPORTSIMULATOR_RANDOM_H
@@ -0,0 +1,205 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+
+#include "replay.h"
+
+static LandingRequestToken landing_token(const JournalEntry &entry) {
+    return LandingRequestToken(AirportState::Proceed, entry.runway, entry.parking_stand,
+                               std::chrono::nanoseconds(entry.expiration), entry.epoch);
+}
+
+static TakeOffRequestToken takeoff_token(const JournalEntry &entry) {
+    return TakeOffRequestToken(AirportState::Proceed, entry.runway, entry.parking_stand,
+                               std::chrono::nanoseconds(entry.expiration), entry.epoch);
+}
+
+/*
+ * Expirations are left out: on the wall clock the airport reads its clock again after the
+ * journaled time.
+ * @return : if token is what the journal says the request got
+ */
+template<typename Token>
+static bool same_token(const JournalEntry &entry, const Token &token) {
+    if (entry.outcome != static_cast<uint8_t>(token.state)) {
+        return false;
+    }
+    return token.state != AirportState::Proceed ||
+           (token.runway == entry.runway && token.parking_stand == entry.parking_stand && token.epoch == entry.epoch);
+}
+
+static bool replay_request_takeoff(const JournalEntry &entry, Airport &airport) {
+    try {
+        return same_token(entry, airport.request_takeoff(entry.aircraft));
+    }
+    catch (std::runtime_error &) {
+        return entry.outcome == kJournalRefused;
+    }
+}
+
+static bool replay_request_landing_async(const JournalEntry &entry, Airport &airport) {
+    // Still written to if the request is only granted later, after this returns.
+    std::shared_ptr<LandingRequestToken> granted = std::make_shared<LandingRequestToken>(AirportState::Hold);
+    airport.request_landing_async(entry.aircraft, [granted] (LandingRequestToken token) { *granted = token; },
+                                  static_cast<LandingPriority>(entry.priority));
+    return same_token(entry, *granted);
+}
+
+static bool replay_request_takeoff_async(const JournalEntry &entry, Airport &airport) {
+    std::shared_ptr<TakeOffRequestToken> granted = std::make_shared<TakeOffRequestToken>(AirportState::Hold);
+    try {
+        airport.request_takeoff_async(entry.aircraft, [granted] (TakeOffRequestToken token) { *granted = token; });
+    }
+    catch (std::runtime_error &) {
+        return entry.outcome == kJournalRefused;
+    }
+    return same_token(entry, *granted);
+}
+
+static bool replay_perform_landing(const JournalEntry &entry, Airport &airport) {
+    bool started = false;
+    try {
+        started = airport.perform_landing(landing_token(entry));
+    }
+    catch (std::runtime_error &) {
+    }
+    return started == (entry.outcome == 1);
+}
+
+static bool replay_perform_takeoff(const JournalEntry &entry, Airport &airport) {
+    bool started = false;
+    try {
+        started = airport.perform_takeoff(takeoff_token(entry));
+    }
+    catch (std::runtime_error &) {
+    }
+    return started == (entry.outcome == 1);
+}
+
+/*
+ * @param batch: the batch's entry; its elements follow it
+ * @return : if every element came out as journaled
+ */
+static bool replay_batch(const std::vector<JournalEntry> &entries, size_t batch, Airport &airport) {
+    const JournalEntry &entry = entries[batch];
+    size_t count = static_cast<size_t>(entry.expiration);
+    std::vector<std::string> aircraft_ids;
+    std::vector<LandingRequestToken> landings;
+    std::vector<TakeOffRequestToken> takeoffs;
+    for (size_t i = batch + 1; i <= batch + count; ++i) {
+        aircraft_ids.push_back(entries[i].aircraft);
+        landings.push_back(landing_token(entries[i]));
+        takeoffs.push_back(takeoff_token(entries[i]));
+    }
+    bool same = true;
+    switch (entry.event) {
+        case JournalEvent::RequestLandingBatch: {
+            std::vector<LandingRequestToken> tokens = airport.request_landing_batch(aircraft_ids);
+            for (size_t i = 0; i < count; ++i) {
+                same = same && same_token(entries[batch + 1 + i], tokens[i]);
+            }
+            break;
+        }
+        case JournalEvent::RequestTakeoffBatch: {
+            std::vector<TakeOffRequestToken> tokens;
+            try {
+                tokens = airport.request_takeoff_batch(aircraft_ids);
+            }
+            catch (std::runtime_error &) {
+                return entry.outcome == kJournalRefused;
+            }
+            for (size_t i = 0; i < count; ++i) {
+                same = same && same_token(entries[batch + 1 + i], tokens[i]);
+            }
+            break;
+        }
+        case JournalEvent::PerformLandingBatch:
+        case JournalEvent::PerformTakeoffBatch: {
+            std::vector<bool> started = entry.event == JournalEvent::PerformLandingBatch ?
+                                        airport.perform_landing_batch(landings) :
+                                        airport.perform_takeoff_batch(takeoffs);
+            for (size_t i = 0; i < count; ++i) {
+                same = same && started[i] == (entries[batch + 1 + i].outcome == 1);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return same;
+}
+
+ReplayStats replay_journal(const std::vector<JournalEntry> &entries, Airport &airport, SimEngine &engine) {
+    ReplayStats stats;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const JournalEntry &entry = entries[i];
+        size_t at = i;
+        std::chrono::nanoseconds time(entry.time);
+        bool same = true;
+        switch (entry.event) {
+            case JournalEvent::Grant:
+                ++stats.grants;
+                engine.run_until(time);
+                continue;
+            case JournalEvent::CompleteLanding:
+            case JournalEvent::CompleteTakeoff:
+                ++stats.completions;
+                engine.run_until(time);
+                continue;
+            case JournalEvent::Expire:
+                ++stats.expiries;
+                engine.run_until(time);
+                continue;
+            case JournalEvent::IdTail:
+                continue;
+            default:
+                break;
+        }
+        engine.run_before(time);
+        ++stats.calls;
+        switch (entry.event) {
+            case JournalEvent::RequestLanding:
+                same = same_token(entry, airport.request_landing(entry.aircraft,
+                                                                 static_cast<LandingPriority>(entry.priority)));
+                break;
+            case JournalEvent::RequestTakeoff:
+                same = replay_request_takeoff(entry, airport);
+                break;
+            case JournalEvent::RequestLandingAsync:
+                same = replay_request_landing_async(entry, airport);
+                break;
+            case JournalEvent::RequestTakeoffAsync:
+                same = replay_request_takeoff_async(entry, airport);
+                break;
+            case JournalEvent::PerformLanding:
+                same = replay_perform_landing(entry, airport);
+                break;
+            case JournalEvent::PerformTakeoff:
+                same = replay_perform_takeoff(entry, airport);
+                break;
+            default: {
+                size_t count = static_cast<size_t>(entry.expiration);
+                if (count > entries.size() - i - 1) {
+                    throw std::runtime_error("Journal is truncated");
+                }
+                same = replay_batch(entries, i, airport);
+                i += count;
+                break;
+            }
+        }
+        if (!same) {
+            ++stats.diverged;
+            if (stats.first_divergence == SIZE_MAX) {
+                stats.first_divergence = at;
+            }
+        }
+    }
+    engine.run();
+    stats.wall_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
@@ -0,0 +1,41 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#ifndef AIRPORTSIMULATOR_REPLAY_H
+#define AIRPORTSIMULATOR_REPLAY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "airport.h"
+#include "sim_engine.h"
+#include "journal.h"
+
+/** What a replay fed to the airport, next to what the journal says the airport did on its own. */
+struct ReplayStats {
+    uint64_t calls = 0;                 // client calls replayed, a batch counting once
+    uint64_t diverged = 0;              // calls whose outcome or token differs from the journal
+    size_t first_divergence = SIZE_MAX; // index of its journal entry
+    uint64_t grants = 0;                // in the journal; the replay makes its own
+    uint64_t completions = 0;
+    uint64_t expiries = 0;
+    double wall_sec = 0;
+};
+
+/*
+ * Feeds the client calls of a journal back to airport as fast as they go, at their journaled
+ * times on engine's clock: before each call the engine runs the events due before it, and those
+ * due at the time of each grant, completion or expiry the journal has ahead of it. Async
+ * requests get a callback that does nothing; the performs their clients made are in the
+ * journal. Every call of a journal recorded on a SimEngine comes out the same; one from the
+ * wall clock may diverge where threads raced for the same resource.
+ * @param entries: a whole journal, see read_journal()
+ * @param airport: runs on engine, in the state the journal started from, e.g. restored from a
+ *                 snapshot taken just before it, with the engine's clock at the snapshot time
+ * @return : counts; the engine is run dry before returning
+ */
+ReplayStats replay_journal(const std::vector<JournalEntry> &entries, Airport &airport, SimEngine &engine);
+
+#endif //AIRPORTSIMULATOR_REPLAY_H
@@ -0,0 +1,32 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include "resource_store.h"
+
+void ResourceStore::reserve(size_t num_runways, size_t num_parking_stands) {
+    runway_states.reserve(num_runways);
+    runway_holders.reserve(num_runways);
+    runway_ids.reserve(num_runways);
+    runway_aircrafts.reserve(num_runways);
+    runway_times.reserve(num_runways);
+    parking_stand_states.reserve(num_parking_stands);
+    parking_stand_ids.reserve(num_parking_stands);
+}
+
+ResourceHandle ResourceStore::add_runway(const std::string &id, uint32_t state_word) {
+    ResourceHandle handle = static_cast<ResourceHandle>(runway_states.size());
+    runway_states.push_back(state_word);
+    runway_holders.push_back(kNoRunwayHolder);
+    runway_ids.push_back(id);
+    runway_aircrafts.emplace_back();
+    runway_times.push_back(0);
+    return handle;
+}
+
+ResourceHandle ResourceStore::add_parking_stand(const std::string &id, uint8_t state) {
+    ResourceHandle handle = static_cast<ResourceHandle>(parking_stand_states.size());
+    parking_stand_states.push_back(state);
+    parking_stand_ids.push_back(id);
+    return handle;
+}
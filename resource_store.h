@@ -0,0 +1,105 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#ifndef AIRPORTSIMULATOR_RESOURCE_STORE_H
+#define AIRPORTSIMULATOR_RESOURCE_STORE_H
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <string>
+#include <mutex>
+
+#include "tokens.h"
+
+/** Contiguous array of atomics. Growing copies the values over and is not thread-safe, like
+ * adding resources to an airport. */
+template<typename T>
+class AtomicArray {
+private:
+    std::unique_ptr<std::atomic<T>[]> cells;
+    size_t count = 0;
+    size_t capacity = 0;
+
+public:
+    void reserve(size_t n) {
+        if (n <= capacity) {
+            return;
+        }
+        std::unique_ptr<std::atomic<T>[]> grown(new std::atomic<T>[n]);
+        for (size_t i = 0; i < count; ++i) {
+            grown[i].store(cells[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        cells.swap(grown);
+        capacity = n;
+    }
+
+    void push_back(T value) {
+        if (count == capacity) {
+            reserve(capacity < 16 ? 16 : 2 * capacity);
+        }
+        cells[count++].store(value, std::memory_order_relaxed);
+    }
+
+    std::atomic<T> &operator[](size_t i) { return cells[i]; }
+    const std::atomic<T> &operator[](size_t i) const { return cells[i]; }
+    size_t size() const { return count; }
+};
+
+/** Holder record of a runway nobody has reserved yet. */
+static constexpr uint64_t kNoRunwayHolder = ~0ULL;
+
+/** Structure-of-arrays storage for an airport's runways and parking stands. Hot state sits in
+ * dense atomic arrays indexed by ResourceHandle; string ids are kept apart for the API edge.
+ * Runway and ParkingStand objects added to an airport become views into this store. */
+class ResourceStore {
+private:
+    AtomicArray<uint32_t> runway_states;            // Runway state word: epoch << 8 | RunwayState
+    AtomicArray<uint8_t> parking_stand_states;      // ParkingStandState
+    AtomicArray<uint64_t> runway_holders;           // who holds the runway's reservation, see Airport
+    std::vector<std::string> runway_ids;
+    std::vector<std::string> parking_stand_ids;
+    std::vector<std::string> runway_aircrafts;      // owned by the holder of the runway's reservation
+    std::vector<int64_t> runway_times;              // likewise
+    static constexpr size_t kAircraftLocks = 64;
+    std::mutex aircraft_locks[kAircraftLocks];      // striped by runway, see copy_runway_aircraft()
+
+    std::mutex &aircraft_lock(ResourceHandle handle) { return aircraft_locks[handle % kAircraftLocks]; }
+
+public:
+    /** Sizes every array once, for bulk construction. */
+    void reserve(size_t num_runways, size_t num_parking_stands);
+    ResourceHandle add_runway(const std::string &id, uint32_t state_word);
+    ResourceHandle add_parking_stand(const std::string &id, uint8_t state);
+
+    std::atomic<uint32_t> &runway_state(ResourceHandle handle) { return runway_states[handle]; }
+    std::atomic<uint8_t> &parking_stand_state(ResourceHandle handle) { return parking_stand_states[handle]; }
+    std::atomic<uint64_t> &runway_holder(ResourceHandle handle) { return runway_holders[handle]; }
+    /** The aircraft a runway is reserved for. Only the thread that holds the reservation, i.e.
+     * that won the runway's last state transition, may touch it, and it writes it with
+     * set_runway_aircraft() before publishing the runway's holder word. */
+    std::string &runway_aircraft(ResourceHandle handle) { return runway_aircrafts[handle]; }
+    /** The new id is copied outside the lock and swapped in under it. */
+    void set_runway_aircraft(ResourceHandle handle, const std::string &aircraft_id) {
+        std::string id(aircraft_id);
+        std::lock_guard<std::mutex> guard(aircraft_lock(handle));
+        runway_aircrafts[handle].swap(id);
+    }
+    /** For threads that do not hold the reservation: the id as of some moment, never half
+     * written. Whose it was must be checked against the runway's epoch afterwards. */
+    std::string copy_runway_aircraft(ResourceHandle handle) {
+        std::lock_guard<std::mutex> guard(aircraft_lock(handle));
+        return runway_aircrafts[handle];
+    }
+    /** When the runway's reservation runs out, in scheduler nanoseconds: its token's expiration
+     * while Reserved, the end of the operation while InOperation. Same rules as runway_aircraft. */
+    int64_t &runway_time(ResourceHandle handle) { return runway_times[handle]; }
+    const std::string &runway_id(ResourceHandle handle) const { return runway_ids[handle]; }
+    const std::string &parking_stand_id(ResourceHandle handle) const { return parking_stand_ids[handle]; }
+    size_t runway_count() const { return runway_states.size(); }
+    size_t parking_stand_count() const { return parking_stand_states.size(); }
+};
+
+#endif //AIRPORTSIMULATOR_RESOURCE_STORE_H
@@ -3,12 +3,68 @@
 //
 
 #include "runway.h"
+#include "resource_store.h"
 
-Runway::Runway() {
-    state = RunwayState::Available;
+Runway::Runway() : index(0) {
+    local_state = pack(0, RunwayState::Available);
 }
 
-Runway::Runway(int id) {
+Runway::Runway(int id) : index(0) {
     runway_id = "r_" + std::to_string(id);
-    state = RunwayState::Available;
-}
\ No newline at end of file
+    local_state = pack(0, RunwayState::Available);
+}
+
+Runway::Runway(const std::string &id) : runway_id(id), index(0) {
+    local_state = pack(0, RunwayState::Available);
+}
+
+std::atomic<uint32_t> &Runway::cell() const {
+    return store ? store->runway_state(index) : local_state;
+}
+
+void Runway::attach(std::shared_ptr<ResourceStore> store, uint32_t index) {
+    Runway::store = store;
+    Runway::index = index;
+}
+
+void Runway::setState(std::atomic<uint32_t> &cell, RunwayState state) {
+    uint32_t word = cell.load();
+    while (!cell.compare_exchange_weak(word, pack(word >> 8, state))) {}
+}
+
+bool Runway::transition(std::atomic<uint32_t> &cell, RunwayState from, RunwayState to) {
+    uint32_t word = cell.load();
+    do {
+        if (state_of(word) != from) {
+            return false;
+        }
+    } while (!cell.compare_exchange_weak(word, pack(word >> 8, to)));
+    return true;
+}
+
+bool Runway::reserve(std::atomic<uint32_t> &cell, uint32_t &epoch) {
+    uint32_t word = cell.load();
+    do {
+        if (state_of(word) != RunwayState::Available) {
+            return false;
+        }
+        epoch = ((word >> 8) + 1) & 0xFFFFFF;
+    } while (!cell.compare_exchange_weak(word, pack(epoch, RunwayState::Reserved)));
+    return true;
+}
+
+bool Runway::transition(std::atomic<uint32_t> &cell, uint32_t epoch, RunwayState from, RunwayState to) {
+    uint32_t word = pack(epoch, from);
+    return cell.compare_exchange_strong(word, pack(epoch, to));
+}
+
+/*
+ * Hands reservation `epoch` over to a new reservation, which stays Reserved under a new epoch.
+ * @param new_epoch: receives the new reservation's epoch
+ * @return : false if reservation `epoch` is no longer the current Reserved one
+ */
+bool Runway::preempt(std::atomic<uint32_t> &cell, uint32_t epoch, uint32_t &new_epoch) {
+    uint32_t word = pack(epoch, RunwayState::Reserved);
+    new_epoch = (epoch + 1) & 0xFFFFFF;
+    return cell.compare_exchange_strong(word, pack(new_epoch, RunwayState::Reserved));
+}
@@ -6,25 +6,57 @@
 #define AIRPORTSIMULATOR_RUNWAY_H
 
 #include <string>
-#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
 
 enum class RunwayState { InOperation, Reserved, Available };
 
-/** A runway, essential for air travel. */
+class ResourceStore;
+
+/** A runway, essential for air travel. Once added to an airport it is a view of that
+ * airport's ResourceStore; the static helpers run the same state machine on any state word. */
 class Runway {
 private:
     std::string runway_id;
     int length;
-    RunwayState state;
+    mutable std::atomic<uint32_t> local_state;     // low byte: RunwayState, upper bits: reservation epoch
+    std::shared_ptr<ResourceStore> store;           // set once the runway joins an airport
+    uint32_t index;
+
+    std::atomic<uint32_t> &cell() const;
 
 public:
-    std::mutex r_lock;
     Runway();
     Runway(int id);
+    explicit Runway(const std::string &id);
 
-    RunwayState getState() const { return state; }
-    void setState(RunwayState state) { Runway::state = state; }
+    static uint32_t pack(uint32_t epoch, RunwayState state) {
+        return (epoch << 8) | static_cast<uint32_t>(state);
+    }
+    static RunwayState state_of(uint32_t word) { return static_cast<RunwayState>(word & 0xFF); }
+    static void setState(std::atomic<uint32_t> &cell, RunwayState state);
+    static bool transition(std::atomic<uint32_t> &cell, RunwayState from, RunwayState to);
+    static bool reserve(std::atomic<uint32_t> &cell, uint32_t &epoch);
+    static bool transition(std::atomic<uint32_t> &cell, uint32_t epoch, RunwayState from, RunwayState to);
+    static bool preempt(std::atomic<uint32_t> &cell, uint32_t epoch, uint32_t &new_epoch);
+
+    RunwayState getState() const { return state_of(cell().load()); }
+    void setState(RunwayState state) { setState(cell(), state); }
+    /** Compare-and-swap from `from` to `to`. Fails if the state was not `from`. */
+    bool transition(RunwayState from, RunwayState to) { return transition(cell(), from, to); }
+    /** Available -> Reserved, starting a new reservation whose epoch is returned in `epoch`. */
+    bool reserve(uint32_t &epoch) { return reserve(cell(), epoch); }
+    /** Like transition(), but only while reservation `epoch` is still the current one. */
+    bool transition(uint32_t epoch, RunwayState from, RunwayState to) {
+        return transition(cell(), epoch, from, to);
+    }
     const std::string &getRunway_id() const { return runway_id; }
+
+    /** Moves the runway's state into slot `index` of `store`. Done by Airport::add_runway. */
+    void attach(std::shared_ptr<ResourceStore> store, uint32_t index);
+    bool attached() const { return store != nullptr; }
+    uint32_t state_word() const { return cell().load(); }
 };
 
 #endif //AIRPORTSIMULATOR_RUNWAY_H
@@ -0,0 +1,24 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#ifndef AIRPORTSIMULATOR_SCHEDULER_H
+#define AIRPORTSIMULATOR_SCHEDULER_H
+
+#include <chrono>
+#include <functional>
+
+/** Clock and delayed work for an Airport. Lets the same airport run on wall time or on a
+ * simulated clock. */
+class Scheduler {
+public:
+    virtual ~Scheduler() = default;
+
+    /** Time since this scheduler's epoch. */
+    virtual std::chrono::nanoseconds now() = 0;
+
+    /** Runs fn once delay has passed on this scheduler's clock. */
+    virtual void schedule_after(std::chrono::nanoseconds delay, std::function<void()> fn) = 0;
+};
+
+#endif //AIRPORTSIMULATOR_SCHEDULER_H
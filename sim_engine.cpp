@@ -0,0 +1,57 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <algorithm>
+
+#include "sim_engine.h"
+
+SimEngine::SimEngine() : clock(0), next_seq(0), processed(0) {}
+
+void SimEngine::schedule_after(std::chrono::nanoseconds delay, std::function<void()> fn) {
+    schedule_at(clock + delay, std::move(fn));
+}
+
+/*
+ * @param when: absolute sim time; anything in the past runs at the current time
+ * @param fn: the event body
+ */
+void SimEngine::schedule_at(std::chrono::nanoseconds when, std::function<void()> fn) {
+    Event event;
+    event.time = std::max(when, clock);
+    event.seq = next_seq++;
+    event.fn = std::move(fn);
+    queue.push_back(std::move(event));
+    std::push_heap(queue.begin(), queue.end(), Later());
+}
+
+bool SimEngine::step() {
+    if (queue.empty()) {
+        return false;
+    }
+    std::pop_heap(queue.begin(), queue.end(), Later());
+    Event event = std::move(queue.back());
+    queue.pop_back();
+    clock = event.time;
+    ++processed;
+    event.fn();
+    return true;
+}
+
+void SimEngine::run() {
+    while (step()) {}
+}
+
+void SimEngine::run_until(std::chrono::nanoseconds end) {
+    while (!queue.empty() && queue.front().time <= end) {
+        step();
+    }
+    clock = std::max(clock, end);
+}
+
+void SimEngine::run_before(std::chrono::nanoseconds end) {
+    while (!queue.empty() && queue.front().time < end) {
+        step();
+    }
+    clock = std::max(clock, end);
+}
@@ -0,0 +1,56 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#ifndef AIRPORTSIMULATOR_SIM_ENGINE_H
+#define AIRPORTSIMULATOR_SIM_ENGINE_H
+
+#include <cstdint>
+#include <vector>
+#include <functional>
+
+#include "scheduler.h"
+
+/** Discrete-event simulation engine. The clock starts at zero and only moves when run()
+ * jumps to the next event, so a busy day takes as long as its events take to execute.
+ * Not thread-safe: the airport and its clients must all run inside events of one engine. */
+class SimEngine : public Scheduler {
+private:
+    struct Event {
+        std::chrono::nanoseconds time;
+        uint64_t seq;                   // keeps events at the same time in FIFO order
+        std::function<void()> fn;
+    };
+    struct Later {
+        bool operator()(const Event &a, const Event &b) const {
+            return a.time != b.time ? a.time > b.time : a.seq > b.seq;
+        }
+    };
+
+    std::vector<Event> queue;           // min-heap on (time, seq)
+    std::chrono::nanoseconds clock;
+    uint64_t next_seq;
+    uint64_t processed;
+
+public:
+    SimEngine();
+
+    std::chrono::nanoseconds now() override { return clock; }
+    void schedule_after(std::chrono::nanoseconds delay, std::function<void()> fn) override;
+    void schedule_at(std::chrono::nanoseconds when, std::function<void()> fn);
+
+    /** Jumps to the next event and runs it. Returns false when there is nothing left. */
+    bool step();
+    /** Runs until the event queue is empty. */
+    void run();
+    /** Runs every event due at or before end, then leaves the clock at end. */
+    void run_until(std::chrono::nanoseconds end);
+    /** Runs every event due before end, then leaves the clock at end, e.g. to slip something in
+     * ahead of the events due then. */
+    void run_before(std::chrono::nanoseconds end);
+
+    size_t pending() const { return queue.size(); }
+    uint64_t events_processed() const { return processed; }
+};
+
+#endif //AIRPORTSIMULATOR_SIM_ENGINE_H
@@ -0,0 +1,83 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <fstream>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+
+static const char kSnapshotMagic[8] = {'A', 'S', 'N', 'A', 'P', 'S', 'H', 'T'};
+static const size_t kSnapshotAlign = 64;
+
+MappedFile::MappedFile(const std::string &path) : base(nullptr), length(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        close(fd);
+        throw std::runtime_error("Cannot open " + path);
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length) {
+        void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Cannot map " + path);
+        }
+        base = static_cast<const char *>(mapped);
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (base) {
+        munmap(const_cast<char *>(base), length);
+    }
+}
+
+SnapshotWriter::SnapshotWriter() : bytes(sizeof(SnapshotHeader), 0) {
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, kSnapshotMagic, sizeof(head.magic));
+    head.version = kSnapshotVersion;
+    head.header_size = sizeof(SnapshotHeader);
+}
+
+uint64_t SnapshotWriter::append(const void *data, size_t size) {
+    size_t offset = (bytes.size() + kSnapshotAlign - 1) / kSnapshotAlign * kSnapshotAlign;
+    bytes.resize(offset + size);
+    if (size) {
+        memcpy(bytes.data() + offset, data, size);
+    }
+    return offset;
+}
+
+void SnapshotWriter::write(const std::string &path) {
+    head.file_size = bytes.size();
+    memcpy(bytes.data(), &head, sizeof(head));
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out || !out.write(bytes.data(), bytes.size())) {
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
+
+const SnapshotHeader &snapshot_header(const MappedFile &file) {
+    if (file.size() < sizeof(SnapshotHeader) || memcmp(file.data(), kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) {
+        throw std::runtime_error("Not an airport snapshot");
+    }
+    const SnapshotHeader &h = *file.array<SnapshotHeader>(0, 1);
+    if (h.version != kSnapshotVersion || h.header_size != sizeof(SnapshotHeader)) {
+        throw std::runtime_error("Unsupported snapshot version");
+    }
+    if (h.file_size != file.size()) {
+        throw std::runtime_error("Snapshot is truncated");
+    }
+    return h;
+}
@@ -0,0 +1,93 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#ifndef AIRPORTSIMULATOR_SNAPSHOT_H
+#define AIRPORTSIMULATOR_SNAPSHOT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+/** Bumped whenever the layout below changes; older snapshots are refused, not converted. */
+static constexpr uint32_t kSnapshotVersion = 1;
+
+/** Start of an airport snapshot file. The rest is flat arrays in host byte order, each starting
+ * at the offset given here, 64-byte aligned, so restore reads them straight out of the mapping.
+ * Times are scheduler nanoseconds; restore shifts them by its own now() - saved_at. */
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t file_size;
+    uint64_t runways;
+    uint64_t parking_stands;
+    uint64_t parked;                    // aircraft in the parking registry
+    int64_t saved_at;
+    int64_t operation_duration;
+    int64_t token_validity;
+    uint64_t runway_states;             // uint32_t[runways], Runway state words
+    uint64_t runway_holders;            // uint64_t[runways]
+    uint64_t runway_times;              // int64_t[runways]
+    uint64_t parking_stand_states;      // uint8_t[parking_stands]
+    uint64_t parked_stands;             // uint32_t[parked]
+    uint64_t string_ends;               // uint64_t[strings]: end of each string in string_data
+    uint64_t string_data;               // runway ids, stand ids, runway aircraft, parked aircraft
+};
+
+/** Read-only private mapping of a whole file, unmapped on destruction. */
+class MappedFile {
+private:
+    const char *base;
+    size_t length;
+
+public:
+    /** Throws if the file cannot be opened or mapped. */
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return base; }
+    size_t size() const { return length; }
+
+    /*
+     * @param offset: start of the array, from the start of the file
+     * @param count: elements
+     * @return : the array, in place; throws if it runs past the end of the file
+     */
+    template<typename T>
+    const T *array(uint64_t offset, uint64_t count) const {
+        if (offset > length || offset % alignof(T) != 0 || count > (length - offset) / sizeof(T)) {
+            throw std::runtime_error("Snapshot is truncated");
+        }
+        return reinterpret_cast<const T *>(base + offset);
+    }
+};
+
+/** Builds a snapshot in memory: a header, then arrays appended at aligned offsets. */
+class SnapshotWriter {
+private:
+    SnapshotHeader head;
+    std::vector<char> bytes;            // head goes in front when written
+
+public:
+    SnapshotWriter();
+    SnapshotHeader &header() { return head; }
+    /*
+     * @return : the offset the array was written at
+     */
+    uint64_t append(const void *data, size_t size);
+    /** Throws if the file cannot be written. */
+    void write(const std::string &path);
+};
+
+/*
+ * Checks magic, version and size.
+ * @return : the file's header; throws if the file is not a snapshot this build can read
+ */
+const SnapshotHeader &snapshot_header(const MappedFile &file);
+
+#endif //AIRPORTSIMULATOR_SNAPSHOT_H
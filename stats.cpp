@@ -0,0 +1,206 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <mutex>
+#include <algorithm>
+
+#include "stats.h"
+
+constexpr int LatencyHistogram::kSubBits;
+constexpr int LatencyHistogram::kBuckets;
+
+static inline int highest_bit(uint64_t v) {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(v);
+#else
+    int b = 0;
+    while (v >>= 1) {
+        ++b;
+    }
+    return b;
+#endif
+}
+
+int LatencyHistogram::bucket_of(uint64_t ns) {
+    if (ns < (1u << kSubBits)) {
+        return static_cast<int>(ns);
+    }
+    int shift = highest_bit(ns) - kSubBits;
+    int sub = static_cast<int>((ns >> shift) & ((1u << kSubBits) - 1));
+    return ((shift + 1) << kSubBits) + sub;
+}
+
+uint64_t LatencyHistogram::bucket_high(int b) {
+    if (b < (1 << kSubBits)) {
+        return static_cast<uint64_t>(b);
+    }
+    int shift = (b >> kSubBits) - 1;
+    uint64_t low = static_cast<uint64_t>((1 << kSubBits) + (b & ((1 << kSubBits) - 1))) << shift;
+    return low + ((uint64_t(1) << shift) - 1);
+}
+
+LatencyHistogram::LatencyHistogram() : counts(kBuckets, 0), total(0), sum(0), max_ns(0) {}
+
+void LatencyHistogram::record(uint64_t ns, uint64_t times) {
+    counts[bucket_of(ns)] += times;
+    total += times;
+    sum += ns * times;
+    max_ns = std::max(max_ns, ns);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+    for (int b = 0; b < kBuckets; ++b) {
+        counts[b] += other.counts[b];
+    }
+    total += other.total;
+    sum += other.sum;
+    max_ns = std::max(max_ns, other.max_ns);
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+    uint64_t target = static_cast<uint64_t>(q * total);
+    uint64_t seen = 0;
+    for (int b = 0; b < kBuckets; ++b) {
+        seen += counts[b];
+        if (seen > target) {
+            return std::min(bucket_high(b), max_ns);
+        }
+    }
+    return max_ns;
+}
+
+/** Slot of the calling thread, unique among live threads. Slots are handed back when a thread
+ * exits, so short-lived test threads do not use up the table. */
+class ThreadSlot {
+private:
+    static std::mutex free_lock;
+    static std::vector<int> free_slots;
+    static int next_slot;
+
+public:
+    int slot;
+
+    ThreadSlot() {
+        std::lock_guard<std::mutex> guard(free_lock);
+        if (free_slots.empty()) {
+            slot = next_slot++;
+        }
+        else {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        }
+    }
+
+    ~ThreadSlot() {
+        std::lock_guard<std::mutex> guard(free_lock);
+        free_slots.push_back(slot);
+    }
+};
+
+std::mutex ThreadSlot::free_lock;
+std::vector<int> ThreadSlot::free_slots;
+int ThreadSlot::next_slot = 0;
+
+static int thread_slot() {
+    static thread_local ThreadSlot slot;
+    return slot.slot;
+}
+
+StatsCollector::Shard::Shard() {
+    for (int op = 0; op < kStatsOps; ++op) {
+        for (auto &c : counts[op]) {
+            c.store(0, std::memory_order_relaxed);
+        }
+        sum[op].store(0, std::memory_order_relaxed);
+        max_ns[op].store(0, std::memory_order_relaxed);
+    }
+}
+
+StatsCollector::StatsCollector() {
+    for (auto &shard : shards) {
+        shard.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+StatsCollector::~StatsCollector() {
+    for (auto &shard : shards) {
+        delete shard.load();
+    }
+}
+
+static inline void bump(std::atomic<uint64_t> &cell, uint64_t by) {
+    cell.store(cell.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+}
+
+/*
+ * Owner-only cells are bumped with a load and a store instead of a locked add. A reader merging
+ * concurrently may miss an in-flight record, never tear one.
+ */
+void StatsCollector::record(StatsOp op, std::chrono::nanoseconds latency) {
+    int o = static_cast<int>(op);
+    uint64_t ns = static_cast<uint64_t>(std::max<int64_t>(0, latency.count()));
+    int slot = thread_slot();
+    if (slot >= kSlots) {
+        overflow.counts[o][LatencyHistogram::bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+        overflow.sum[o].fetch_add(ns, std::memory_order_relaxed);
+        uint64_t seen = overflow.max_ns[o].load(std::memory_order_relaxed);
+        while (ns > seen && !overflow.max_ns[o].compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {}
+        return;
+    }
+    Shard *shard = shards[slot].load(std::memory_order_acquire);
+    if (!shard) {
+        shard = new Shard();
+        shards[slot].store(shard, std::memory_order_release);
+    }
+    bump(shard->counts[o][LatencyHistogram::bucket_of(ns)], 1);
+    bump(shard->sum[o], ns);
+    if (ns > shard->max_ns[o].load(std::memory_order_relaxed)) {
+        shard->max_ns[o].store(ns, std::memory_order_relaxed);
+    }
+}
+
+void StatsCollector::add_runway() {
+    runway_failures.emplace_back(0);
+}
+
+void StatsCollector::add_parking_stand() {
+    parking_stand_failures.emplace_back(0);
+}
+
+AirportStats StatsCollector::snapshot() const {
+    LatencyHistogram merged[kStatsOps];
+    auto add = [&merged](const Shard &shard) {
+        for (int op = 0; op < kStatsOps; ++op) {
+            LatencyHistogram &h = merged[op];
+            for (int b = 0; b < LatencyHistogram::kBuckets; ++b) {
+                uint64_t n = shard.counts[op][b].load(std::memory_order_relaxed);
+                h.counts[b] += n;
+                h.total += n;
+            }
+            h.sum += shard.sum[op].load(std::memory_order_relaxed);
+            h.max_ns = std::max(h.max_ns, shard.max_ns[op].load(std::memory_order_relaxed));
+        }
+    };
+    for (auto &slot : shards) {
+        Shard *shard = slot.load(std::memory_order_acquire);
+        if (shard) {
+            add(*shard);
+        }
+    }
+    add(overflow);
+
+    AirportStats stats;
+    stats.request_landing = merged[static_cast<int>(StatsOp::RequestLanding)];
+    stats.request_takeoff = merged[static_cast<int>(StatsOp::RequestTakeoff)];
+    stats.perform_landing = merged[static_cast<int>(StatsOp::PerformLanding)];
+    stats.perform_takeoff = merged[static_cast<int>(StatsOp::PerformTakeoff)];
+    stats.hold_wait = merged[static_cast<int>(StatsOp::HoldWait)];
+    for (auto &failures : runway_failures) {
+        stats.runway_reserve_failures.push_back(failures.load(std::memory_order_relaxed));
+    }
+    for (auto &failures : parking_stand_failures) {
+        stats.parking_stand_reserve_failures.push_back(failures.load(std::memory_order_relaxed));
+    }
+    return stats;
+}
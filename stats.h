@@ -0,0 +1,123 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#ifndef AIRPORTSIMULATOR_STATS_H
+#define AIRPORTSIMULATOR_STATS_H
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <vector>
+
+#include "tokens.h"
+
+/** HDR-style histogram of nanosecond latencies: values below 8 get a bucket each, above that
+ * every power of two is split into 8 linear sub-buckets, so a bucket is within 12.5% of any
+ * value in it. Plain value type, used for merged snapshots. */
+class LatencyHistogram {
+public:
+    static constexpr int kSubBits = 3;
+    static constexpr int kBuckets = (64 - kSubBits + 1) << kSubBits;
+
+    static int bucket_of(uint64_t ns);
+    /** Largest value that lands in bucket b. */
+    static uint64_t bucket_high(int b);
+
+    LatencyHistogram();
+    void record(uint64_t ns, uint64_t times = 1);
+    void merge(const LatencyHistogram &other);
+    uint64_t count() const { return total; }
+    uint64_t max() const { return max_ns; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0; }
+    /** Upper bound of the bucket holding quantile q, never more than max(). */
+    uint64_t percentile(double q) const;
+
+private:
+    std::vector<uint64_t> counts;
+    uint64_t total;
+    uint64_t sum;
+    uint64_t max_ns;
+
+    friend class StatsCollector;
+};
+
+enum class StatsOp { RequestLanding, RequestTakeoff, PerformLanding, PerformTakeoff, HoldWait };
+static constexpr int kStatsOps = 5;
+
+/** Snapshot returned by Airport::stats(). */
+struct AirportStats {
+    LatencyHistogram request_landing;
+    LatencyHistogram request_takeoff;
+    LatencyHistogram perform_landing;
+    LatencyHistogram perform_takeoff;
+    LatencyHistogram hold_wait;     // Hold -> Proceed in the wait queue, on the airport's clock
+    std::vector<uint64_t> runway_reserve_failures;          // indexed by ResourceHandle
+    std::vector<uint64_t> parking_stand_reserve_failures;
+};
+
+/** Latency histograms kept per thread and merged on read. A thread only ever writes its own
+ * shard, with plain relaxed stores, so recording costs a bucket lookup and two increments.
+ * Threads beyond kSlots share an overflow shard and pay for atomic adds. */
+class StatsCollector {
+private:
+    static constexpr int kSlots = 64;
+
+    struct Shard {
+        std::atomic<uint64_t> counts[kStatsOps][LatencyHistogram::kBuckets];
+        std::atomic<uint64_t> sum[kStatsOps];
+        std::atomic<uint64_t> max_ns[kStatsOps];
+        Shard();
+    };
+
+    std::atomic<Shard *> shards[kSlots];
+    Shard overflow;
+    std::deque<std::atomic<uint64_t>> runway_failures;
+    std::deque<std::atomic<uint64_t>> parking_stand_failures;
+    std::atomic<bool> timing {true};
+
+public:
+    StatsCollector();
+    ~StatsCollector();
+    StatsCollector(const StatsCollector &) = delete;
+    StatsCollector &operator=(const StatsCollector &) = delete;
+
+    void record(StatsOp op, std::chrono::nanoseconds latency);
+    /** The two clock reads around each timed call cost more than recording; this turns them off. */
+    void set_timing(bool on) { timing.store(on, std::memory_order_relaxed); }
+    bool timing_on() const { return timing.load(std::memory_order_relaxed); }
+    /** Not thread-safe, like adding resources. */
+    void add_runway();
+    void add_parking_stand();
+    void runway_reserve_failed(ResourceHandle handle) {
+        runway_failures[handle].fetch_add(1, std::memory_order_relaxed);
+    }
+    void parking_stand_reserve_failed(ResourceHandle handle) {
+        parking_stand_failures[handle].fetch_add(1, std::memory_order_relaxed);
+    }
+    AirportStats snapshot() const;
+};
+
+/** Records the time until the end of the scope, exceptions included, if timing is on. */
+class ScopedLatency {
+private:
+    StatsCollector &stats;
+    StatsOp op;
+    bool on;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    ScopedLatency(StatsCollector &stats, StatsOp op) : stats(stats), op(op), on(stats.timing_on()) {
+        if (on) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+    ~ScopedLatency() {
+        if (on) {
+            stats.record(op, std::chrono::steady_clock::now() - start);
+        }
+    }
+};
+
+#endif //AIRPORTSIMULATOR_STATS_H
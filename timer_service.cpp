@@ -0,0 +1,98 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <algorithm>
+
+#include "timer_service.h"
+
+TimerService::TimerService(unsigned num_workers) : next_seq(0), stopping(false), timers_done(false) {
+    timer_thread = std::thread(&TimerService::timer_loop, this);
+    for (unsigned i = 0; i < std::max(num_workers, 1u); ++i) {
+        workers.emplace_back(&TimerService::worker_loop, this);
+    }
+}
+
+TimerService::~TimerService() {
+    {
+        std::lock_guard<std::mutex> guard(t_lock);
+        stopping = true;
+    }
+    timer_cv.notify_one();
+    timer_thread.join();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+std::chrono::nanoseconds TimerService::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch());
+}
+
+void TimerService::schedule_after(std::chrono::nanoseconds delay, std::function<void()> fn) {
+    Timer timer;
+    timer.deadline = std::chrono::steady_clock::now() +
+                     std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay);
+    timer.fn = std::move(fn);
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> guard(t_lock);
+        uint64_t seq = next_seq++;
+        timer.seq = seq;
+        timers.push_back(std::move(timer));
+        std::push_heap(timers.begin(), timers.end(), Later());
+        earliest = timers.front().seq == seq;   // only a new earliest deadline needs a wake-up
+    }
+    if (earliest) {
+        timer_cv.notify_one();
+    }
+}
+
+/*
+ * Sleeps until the earliest deadline and moves everything due onto the ready queue.
+ */
+void TimerService::timer_loop() {
+    std::unique_lock<std::mutex> guard(t_lock);
+    for (;;) {
+        if (stopping) {
+            timers.clear();
+            break;
+        }
+        if (timers.empty()) {
+            timer_cv.wait(guard);
+            continue;
+        }
+        auto deadline = timers.front().deadline;
+        if (std::chrono::steady_clock::now() < deadline) {
+            timer_cv.wait_until(guard, deadline);
+            continue;
+        }
+        while (!timers.empty() && timers.front().deadline <= deadline) {
+            std::pop_heap(timers.begin(), timers.end(), Later());
+            ready.push_back(std::move(timers.back().fn));
+            timers.pop_back();
+        }
+        ready_cv.notify_all();
+    }
+    timers_done = true;
+    ready_cv.notify_all();
+}
+
+void TimerService::worker_loop() {
+    std::unique_lock<std::mutex> guard(t_lock);
+    for (;;) {
+        if (ready.empty()) {
+            if (timers_done) {
+                break;
+            }
+            ready_cv.wait(guard);
+            continue;
+        }
+        std::function<void()> fn = std::move(ready.front());
+        ready.pop_front();
+        guard.unlock();
+        fn();
+        guard.lock();
+    }
+}
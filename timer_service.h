@@ -0,0 +1,58 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#ifndef AIRPORTSIMULATOR_TIMER_SERVICE_H
+#define AIRPORTSIMULATOR_TIMER_SERVICE_H
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "scheduler.h"
+
+/** Wall-clock Scheduler. One timer thread keeps every pending deadline in a min-heap and hands
+ * due work to a fixed set of workers, so the thread count stays the same however many
+ * operations are in progress. */
+class TimerService : public Scheduler {
+private:
+    struct Timer {
+        std::chrono::steady_clock::time_point deadline;
+        uint64_t seq;
+        std::function<void()> fn;
+    };
+    struct Later {
+        bool operator()(const Timer &a, const Timer &b) const {
+            return a.deadline != b.deadline ? a.deadline > b.deadline : a.seq > b.seq;
+        }
+    };
+
+    std::vector<Timer> timers;                  // min-heap on (deadline, seq)
+    std::deque<std::function<void()>> ready;    // due work waiting for a worker
+    std::mutex t_lock;
+    std::condition_variable timer_cv;
+    std::condition_variable ready_cv;
+    uint64_t next_seq;
+    bool stopping;
+    bool timers_done;
+    std::thread timer_thread;
+    std::vector<std::thread> workers;
+
+    void timer_loop();
+    void worker_loop();
+
+public:
+    explicit TimerService(unsigned num_workers = 2);
+    /** Drops timers that are not due yet, finishes work already handed to the workers and
+     * joins the threads. Owners that need their work to run must wait for it first. */
+    ~TimerService();
+
+    /** steady_clock since its epoch: monotonic, so a wall-clock step cannot expire tokens early. */
+    std::chrono::nanoseconds now() override;
+    void schedule_after(std::chrono::nanoseconds delay, std::function<void()> fn) override;
+};
+
+#endif //AIRPORTSIMULATOR_TIMER_SERVICE_H
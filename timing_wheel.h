@@ -0,0 +1,187 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#ifndef AIRPORTSIMULATOR_TIMING_WHEEL_H
+#define AIRPORTSIMULATOR_TIMING_WHEEL_H
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+/** Hierarchical timing wheel: four levels of 256 slots cover 2^32 ticks. Insert is O(1), and a
+ * tick only touches one level-0 slot plus, every 256 ticks, one slot of a coarser level that is
+ * cascaded down. The cost of a tick does not grow with the number of outstanding items.
+ * Not thread-safe. */
+static inline int lowest_bit(uint64_t v) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(v);
+#else
+    int b = 0;
+    while (!(v & 1)) {
+        v >>= 1;
+        ++b;
+    }
+    return b;
+#endif
+}
+
+template<typename T>
+class TimingWheel {
+private:
+    static constexpr int kLevels = 4;
+    static constexpr int kSlotBits = 8;
+    static constexpr uint64_t kSlots = 1u << kSlotBits;
+
+    struct Entry {
+        uint64_t deadline;
+        T item;
+    };
+
+    static constexpr int kWords = kSlots / 64;
+
+    std::vector<Entry> slots[kLevels][kSlots];
+    uint64_t occupied[kLevels][kWords];             // bit per non-empty slot, for next_due()
+    std::vector<Entry> overflow;                    // further away than the wheel can hold
+    uint64_t now_tick;
+    size_t count;
+
+    void place(Entry entry, uint64_t earliest) {
+        entry.deadline = std::max(entry.deadline, earliest);
+        uint64_t delta = entry.deadline - now_tick;
+        for (int level = 0; level < kLevels; ++level) {
+            if (delta < (uint64_t(1) << (kSlotBits * (level + 1)))) {
+                uint64_t index = (entry.deadline >> (kSlotBits * level)) & (kSlots - 1);
+                slots[level][index].push_back(entry);
+                occupied[level][index / 64] |= uint64_t(1) << (index % 64);
+                return;
+            }
+        }
+        overflow.push_back(entry);
+    }
+
+    void clear_bit(int level, uint64_t index) {
+        occupied[level][index / 64] &= ~(uint64_t(1) << (index % 64));
+    }
+
+    /** First occupied slot of level at or after index, going round; kSlots if none. */
+    uint64_t next_occupied(int level, uint64_t index) const {
+        for (int n = 0; n <= kWords; ++n) {
+            uint64_t word = (index / 64 + n) % kWords;
+            uint64_t bits = occupied[level][word];
+            if (n == 0) {
+                bits &= ~uint64_t(0) << (index % 64);
+            }
+            else if (n == kWords) {
+                bits &= ~(~uint64_t(0) << (index % 64));
+            }
+            if (bits) {
+                return word * 64 + lowest_bit(bits);
+            }
+        }
+        return kSlots;
+    }
+
+    void cascade(int level, uint64_t index) {
+        std::vector<Entry> entries;
+        entries.swap(slots[level][index]);
+        clear_bit(level, index);
+        for (auto &entry : entries) {
+            place(entry, now_tick);
+        }
+    }
+
+public:
+    TimingWheel() : now_tick(0), count(0) {
+        for (auto &level : occupied) {
+            std::fill(level, level + kWords, 0);
+        }
+    }
+
+    /** Adds item to fire at deadline. Anything not in the future fires on the next tick. */
+    void insert(uint64_t deadline, const T &item) {
+        Entry entry;
+        entry.deadline = deadline;
+        entry.item = item;
+        place(entry, now_tick + 1);
+        ++count;
+    }
+
+    /*
+     * Moves the wheel forward to tick.
+     * @param tick: the new current tick; going backwards is a no-op
+     * @param due: receives every item whose deadline is at or before tick
+     */
+    void advance(uint64_t tick, std::vector<T> &due) {
+        while (now_tick < tick) {
+            if (count == 0) {
+                now_tick = tick;                    // nothing to fire, skip the empty ticks
+                return;
+            }
+            uint64_t next = next_due();             // nothing fires or cascades before it
+            if (next > now_tick + 1) {
+                now_tick = std::min(tick, next - 1);
+                continue;
+            }
+            ++now_tick;
+            uint64_t index = now_tick & (kSlots - 1);
+            if (index == 0) {
+                for (int level = 1; level < kLevels; ++level) {
+                    uint64_t upper = (now_tick >> (kSlotBits * level)) & (kSlots - 1);
+                    cascade(level, upper);
+                    if (upper != 0) {
+                        break;
+                    }
+                    if (level == kLevels - 1) {
+                        std::vector<Entry> entries;
+                        entries.swap(overflow);
+                        for (auto &entry : entries) {
+                            place(entry, now_tick);
+                        }
+                    }
+                }
+            }
+            std::vector<Entry> &slot = slots[0][index];
+            for (auto &entry : slot) {
+                due.push_back(entry.item);
+            }
+            count -= slot.size();
+            slot.clear();
+            clear_bit(0, index);
+        }
+    }
+
+    /*
+     * A tick no later than the earliest deadline, so a caller can sleep until then instead of
+     * ticking through empty slots. Exact for deadlines within 256 ticks, otherwise the tick at
+     * which their coarser slot cascades down.
+     * @return : UINT64_MAX if the wheel is empty
+     */
+    uint64_t next_due() const {
+        if (count == 0) {
+            return UINT64_MAX;
+        }
+        uint64_t best = UINT64_MAX;
+        for (int level = 0; level < kLevels; ++level) {
+            int shift = kSlotBits * level;
+            uint64_t current = now_tick >> shift;
+            if (((current + 1) << shift) >= best) {
+                break;                              // coarser levels cannot come sooner
+            }
+            uint64_t slot = next_occupied(level, (current + 1) & (kSlots - 1));
+            if (slot != kSlots) {
+                uint64_t k = ((slot - current - 1) & (kSlots - 1)) + 1;
+                best = std::min(best, std::max(now_tick + 1, (current + k) << shift));
+            }
+        }
+        if (!overflow.empty()) {
+            best = std::min(best, ((now_tick >> (kSlotBits * kLevels)) + 1) << (kSlotBits * kLevels));
+        }
+        return best;
+    }
+
+    size_t size() const { return count; }
+    uint64_t current() const { return now_tick; }
+};
+
+#endif //AIRPORTSIMULATOR_TIMING_WHEEL_H
@@ -5,52 +5,74 @@
 #ifndef AIRPORTSIMULATOR_TOKENS_H
 #define AIRPORTSIMULATOR_TOKENS_H
 
-#include <string>
 #include <chrono>
+#include <type_traits>
+#include <cstdint>
 
-enum class AirportState { Hold, Proceed };
+enum class AirportState : uint8_t { Hold, Proceed };
+
+/** Landing request classes, lowest first. Higher classes are granted first, and an Emergency
+ * may take over the runway and stand of a lower class's landing reservation. */
+enum class LandingPriority : uint8_t { Routine, Priority, Emergency };
+static constexpr int kLandingPriorities = 3;
+
+/** Dense index of a runway or parking stand inside its airport. String ids are only looked up
+ * at the API edge, see Airport::find_runway() and Airport::find_parking_stand(). */
+typedef uint32_t ResourceHandle;
+static constexpr ResourceHandle kInvalidHandle = 0xFFFFFFFF;
+
+/* Tokens are small trivially copyable values: handles into the issuing airport, the expiration
+ * and the runway reservation epoch, no strings. Expirations are nanoseconds on the airport's
+ * monotonic clock; a token can be performed up to and including its expiration. The epoch is
+ * the runway's generation: a token whose reservation was preempted or lapsed fails its perform
+ * on one compare-and-swap, whatever the runway holds now. The aircraft is remembered by the
+ * airport for as long as the reservation stands, see Airport::aircraft_of(). */
 
 class LandingRequestToken {
 public:
-    AirportState state;
-    std::string aircraft_id;
-    std::string runway_id;
-    std::string parking_stand_id;
-    time_t expiration;
+    std::chrono::nanoseconds expiration {0};
+    ResourceHandle runway = kInvalidHandle;
+    ResourceHandle parking_stand = kInvalidHandle;
+    uint32_t epoch = 0;
+    AirportState state = AirportState::Hold;
 
     LandingRequestToken() = default;
 
     LandingRequestToken(AirportState state) : state(state) {}
 
-    LandingRequestToken(AirportState state, const std::string &aircraft_id,
-                        const std::string &runway_id, const std::string &parking_stand_id, int secs) :
-            state(state),
-            aircraft_id(aircraft_id),
-            runway_id(runway_id),
-            parking_stand_id(parking_stand_id) {
-        std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-        expiration = std::chrono::system_clock::to_time_t(now + std::chrono::seconds(secs));
-    }
+    LandingRequestToken(AirportState state, ResourceHandle runway, ResourceHandle parking_stand,
+                        std::chrono::nanoseconds expiration, uint32_t epoch) :
+            expiration(expiration),
+            runway(runway),
+            parking_stand(parking_stand),
+            epoch(epoch),
+            state(state) {}
 };
 
 class TakeOffRequestToken {
 public:
-    AirportState state;
-    std::string aircraft_id;
-    std::string runway_id;
-    time_t expiration;
+    std::chrono::nanoseconds expiration {0};
+    ResourceHandle runway = kInvalidHandle;
+    ResourceHandle parking_stand = kInvalidHandle;
+    uint32_t epoch = 0;
+    AirportState state = AirportState::Hold;
 
     TakeOffRequestToken() = default;
 
     TakeOffRequestToken(AirportState state) : state(state) {}
 
-    TakeOffRequestToken(AirportState state, const std::string &aircraft_id,
-                        const std::string &runway_id, int secs) : state(state),
-                                                             aircraft_id(aircraft_id),
-                                                             runway_id(runway_id) {
-        std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-        expiration = std::chrono::system_clock::to_time_t(now +  std::chrono::seconds(secs));
-    }
+    TakeOffRequestToken(AirportState state, ResourceHandle runway, ResourceHandle parking_stand,
+                        std::chrono::nanoseconds expiration, uint32_t epoch) :
+            expiration(expiration),
+            runway(runway),
+            parking_stand(parking_stand),
+            epoch(epoch),
+            state(state) {}
 };
 
+static_assert(std::is_trivially_copyable<LandingRequestToken>::value && sizeof(LandingRequestToken) <= 24,
+              "tokens are copied freely and may sit in lock-free queues");
+static_assert(std::is_trivially_copyable<TakeOffRequestToken>::value && sizeof(TakeOffRequestToken) <= 24,
+              "tokens are copied freely and may sit in lock-free queues");
+
 #endif //AIRPORTSIMULATOR_TOKENS_H
@@ -0,0 +1,251 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "trace.h"
+
+static_assert(sizeof(TraceRecord) == 24, "trace records are written to disk as they are");
+static_assert((kTraceRingSize & (kTraceRingSize - 1)) == 0, "ring size must be a power of two");
+
+static const char kTraceMagic[8] = {'A', 'T', 'R', 'A', 'C', 'E', '0', '1'};
+
+/** The TSC where there is one: a steady_clock read costs several times the rest of a record. */
+static inline uint64_t read_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+namespace {
+
+struct TraceRing {
+    std::atomic<uint64_t> head {0};     // records ever written; only the owner stores it
+    TraceRecord records[kTraceRingSize];
+};
+
+/** Every ring ever made, and the ones whose threads have exited. Never destroyed, so threads
+ * that outlive main's statics can still record. */
+struct TraceRegistry {
+    std::mutex r_lock;
+    std::vector<TraceRing *> rings;
+    std::vector<TraceRing *> free_rings;
+    uint16_t next_tid = 0;
+    uint64_t base_ticks = read_ticks();
+    std::chrono::steady_clock::time_point base_time = std::chrono::steady_clock::now();
+};
+
+TraceRegistry &registry() {
+    static TraceRegistry *instance = new TraceRegistry();
+    return *instance;
+}
+
+/** The calling thread's ring, taken on its first record and handed back when it exits. */
+class RingHolder {
+public:
+    TraceRing *ring;
+    uint16_t tid;
+
+    RingHolder() {
+        TraceRegistry &r = registry();
+        std::lock_guard<std::mutex> guard(r.r_lock);
+        if (r.free_rings.empty()) {
+            ring = new TraceRing();
+            r.rings.push_back(ring);
+        }
+        else {
+            ring = r.free_rings.back();
+            r.free_rings.pop_back();
+        }
+        tid = r.next_tid++;
+    }
+
+    ~RingHolder() {
+        TraceRegistry &r = registry();
+        std::lock_guard<std::mutex> guard(r.r_lock);
+        r.free_rings.push_back(ring);
+    }
+};
+
+}
+
+void trace_record(TraceEvent event, TracePhase phase, uint32_t a, uint32_t b, uint32_t c) {
+    static thread_local RingHolder holder;
+    TraceRing *ring = holder.ring;
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    TraceRecord &record = ring->records[head & (kTraceRingSize - 1)];
+    record.ticks = read_ticks();
+    record.a = a;
+    record.b = b;
+    record.c = c;
+    record.event = event;
+    record.phase = phase;
+    record.tid = holder.tid;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+/*
+ * Tick length, measured against steady_clock over the life of the process. A dump right after
+ * start waits a few milliseconds so the measurement means something.
+ */
+static double measure_ns_per_tick(const TraceRegistry &r) {
+#if defined(__x86_64__) || defined(__i386__)
+    std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - r.base_time;
+    if (elapsed < std::chrono::milliseconds(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10) - elapsed);
+    }
+    uint64_t ticks = read_ticks() - r.base_ticks;
+    elapsed = std::chrono::steady_clock::now() - r.base_time;
+    return ticks ? static_cast<double>(elapsed.count()) / ticks : 1;
+#else
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::duration(1)).count();
+#endif
+}
+
+/*
+ * Layout, host byte order: magic, ns_per_tick (double), base_ticks (u64), ring count (u32),
+ * then per ring a record count (u32) and its records, oldest first.
+ */
+bool trace_dump(const std::string &path) {
+    TraceRegistry &r = registry();
+    std::vector<TraceRing *> rings;
+    uint64_t base_ticks;
+    {
+        std::lock_guard<std::mutex> guard(r.r_lock);
+        rings = r.rings;
+        base_ticks = r.base_ticks;
+    }
+    double ns_per_tick = measure_ns_per_tick(r);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+    uint32_t count = static_cast<uint32_t>(rings.size());
+    out.write(kTraceMagic, sizeof(kTraceMagic));
+    out.write(reinterpret_cast<const char *>(&ns_per_tick), sizeof(ns_per_tick));
+    out.write(reinterpret_cast<const char *>(&base_ticks), sizeof(base_ticks));
+    out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    for (TraceRing *ring : rings) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint32_t n = static_cast<uint32_t>(std::min<uint64_t>(head, kTraceRingSize));
+        out.write(reinterpret_cast<const char *>(&n), sizeof(n));
+        for (uint64_t i = head - n; i < head; ++i) {
+            out.write(reinterpret_cast<const char *>(&ring->records[i & (kTraceRingSize - 1)]), sizeof(TraceRecord));
+        }
+    }
+    return static_cast<bool>(out);
+}
+
+/*
+ * Records are regrouped by thread, since a recycled ring holds the records of several.
+ */
+bool trace_load(const std::string &path, TraceFile &file) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(kTraceMagic)];
+    uint32_t count;
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, kTraceMagic, sizeof(magic)) != 0 ||
+        !in.read(reinterpret_cast<char *>(&file.ns_per_tick), sizeof(file.ns_per_tick)) ||
+        !in.read(reinterpret_cast<char *>(&file.base_ticks), sizeof(file.base_ticks)) ||
+        !in.read(reinterpret_cast<char *>(&count), sizeof(count))) {
+        return false;
+    }
+    std::vector<TraceThread> threads;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t n;
+        if (!in.read(reinterpret_cast<char *>(&n), sizeof(n)) || n > kTraceRingSize) {
+            return false;
+        }
+        std::vector<TraceRecord> records(n);
+        if (n && !in.read(reinterpret_cast<char *>(records.data()), n * sizeof(TraceRecord))) {
+            return false;
+        }
+        for (auto &record : records) {
+            if (threads.size() <= record.tid) {
+                threads.resize(record.tid + 1u);
+            }
+            threads[record.tid].records.push_back(record);
+        }
+    }
+    file.threads.clear();
+    for (size_t tid = 0; tid < threads.size(); ++tid) {
+        if (!threads[tid].records.empty()) {
+            threads[tid].tid = static_cast<uint32_t>(tid);
+            file.threads.push_back(std::move(threads[tid]));
+        }
+    }
+    return true;
+}
+
+static const char *kEventNames[kTraceEvents] = {
+        "request_landing", "request_takeoff", "perform_landing", "perform_takeoff",
+        "reserve", "reserve_failed", "preempt", "grant",
+        "complete_landing", "complete_takeoff", "complete_landings", "complete_takeoffs",
+        "expire_tokens", "expire"
+};
+
+/** Names of a, b and c per event; nullptr for an unused field. */
+static const char *kArgNames[kTraceEvents][3] = {
+        {"priority", nullptr, nullptr}, {nullptr, nullptr, nullptr},
+        {"runway", "stand", "epoch"}, {"runway", "stand", "epoch"},
+        {"runway", "stand", "epoch"}, {"runway", "stand", "stand_failed"},
+        {"runway", "stand", "epoch"}, {"runway", "stand", "epoch"},
+        {"runway", "stand", nullptr}, {"runway", "stand", nullptr},
+        {"count", nullptr, nullptr}, {"count", nullptr, nullptr},
+        {nullptr, nullptr, nullptr}, {"runway", "stand", "epoch"}
+};
+
+const char *trace_event_name(TraceEvent event) {
+    int e = static_cast<int>(event);
+    return e < kTraceEvents ? kEventNames[e] : "unknown";
+}
+
+void write_chrome_trace(const TraceFile &file, std::ostream &out) {
+    static const char kPhases[] = {'B', 'E', 'i'};
+    std::ios::fmtflags flags = out.flags();
+    out << "{\"traceEvents\": [";
+    bool first = true;
+    for (auto &thread : file.threads) {
+        for (auto &record : thread.records) {
+            int e = static_cast<int>(record.event);
+            int phase = static_cast<int>(record.phase);
+            if (e >= kTraceEvents || phase > 2) {
+                continue;       // torn by a write during the dump
+            }
+            double us = static_cast<double>(record.ticks - file.base_ticks) * file.ns_per_tick / 1000;
+            out << (first ? "\n" : ",\n") << "  {\"name\": \"" << kEventNames[e] << "\", \"cat\": \"airport\", \"ph\": \""
+                << kPhases[phase] << "\", \"ts\": " << std::fixed << std::setprecision(3) << us
+                << ", \"pid\": 1, \"tid\": " << thread.tid;
+            if (record.phase == TracePhase::Instant) {
+                out << ", \"s\": \"t\"";
+            }
+            const uint32_t values[3] = {record.a, record.b, record.c};
+            out << ", \"args\": {";
+            bool first_arg = true;
+            for (int i = 0; i < 3; ++i) {
+                if (kArgNames[e][i]) {
+                    out << (first_arg ? "" : ", ") << '"' << kArgNames[e][i] << "\": " << values[i];
+                    first_arg = false;
+                }
+            }
+            out << "}}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    out.flags(flags);
+}
@@ -0,0 +1,103 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#ifndef AIRPORTSIMULATOR_TRACE_H
+#define AIRPORTSIMULATOR_TRACE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ostream>
+
+/** What a trace record marks. Names for the exported trace are in trace.cpp. */
+enum class TraceEvent : uint8_t {
+    RequestLanding, RequestTakeoff, PerformLanding, PerformTakeoff,
+    Reserve, ReserveFailed, Preempt, Grant,
+    CompleteLanding, CompleteTakeoff, CompleteLandings, CompleteTakeoffs,
+    ExpireTokens, Expire
+};
+static constexpr int kTraceEvents = 14;
+
+enum class TracePhase : uint8_t { Begin, End, Instant };
+
+/** One fixed-size trace record. Timestamps are raw clock ticks; the file header says how long
+ * a tick is. The meaning of a, b and c depends on the event, usually runway, stand and epoch.
+ * tid numbers threads in the order they first recorded, wrapping at 65536. */
+struct TraceRecord {
+    uint64_t ticks;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    TraceEvent event;
+    TracePhase phase;
+    uint16_t tid;
+};
+
+/** Records kept per thread; older ones are overwritten. A ring outlives its thread and is handed
+ * to the next thread that starts recording, so a dump still shows threads that have exited. */
+static constexpr uint32_t kTraceRingSize = 1 << 14;
+
+/*
+ * Appends a record to the calling thread's ring. Only the owning thread writes a ring, so this
+ * is a clock read and a few plain stores.
+ */
+void trace_record(TraceEvent event, TracePhase phase, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0);
+
+/** Begin on construction, End on destruction, exceptions included. */
+class TraceScope {
+private:
+    TraceEvent event;
+    uint32_t a, b, c;
+
+public:
+    TraceScope(TraceEvent event, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0) : event(event), a(a), b(b), c(c) {
+        trace_record(event, TracePhase::Begin, a, b, c);
+    }
+    ~TraceScope() {
+        trace_record(event, TracePhase::End, a, b, c);
+    }
+};
+
+/** Trace points in the airport. They are compiled in only with AIRPORT_TRACE defined (cmake
+ * -DAIRPORT_TRACE=ON); otherwise they expand to nothing and their arguments are not evaluated. */
+#ifdef AIRPORT_TRACE
+#define TRACE_SCOPE(event, ...) TraceScope trace_scope_(TraceEvent::event, ##__VA_ARGS__)
+#define TRACE_INSTANT(event, ...) trace_record(TraceEvent::event, TracePhase::Instant, ##__VA_ARGS__)
+#else
+#define TRACE_SCOPE(event, ...) do {} while (0)
+#define TRACE_INSTANT(event, ...) do {} while (0)
+#endif
+
+/** The rings of every thread that recorded, as read back from a dump. */
+struct TraceThread {
+    uint32_t tid;
+    std::vector<TraceRecord> records;   // oldest first
+};
+
+struct TraceFile {
+    double ns_per_tick;
+    uint64_t base_ticks;                // earliest timestamp of the process
+    std::vector<TraceThread> threads;
+};
+
+/*
+ * Writes every thread's ring to path in the binary trace format. The rings are copied as they
+ * are, so records written during the dump may come out torn; dump once the airport is idle.
+ * @return : if the file was written
+ */
+bool trace_dump(const std::string &path);
+
+/*
+ * @return : if path held a trace dump, which is then in file
+ */
+bool trace_load(const std::string &path, TraceFile &file);
+
+/*
+ * Chrome/Perfetto trace JSON ("traceEvents" with B, E and i phases, microsecond timestamps).
+ */
+void write_chrome_trace(const TraceFile &file, std::ostream &out);
+
+const char *trace_event_name(TraceEvent event);
+
+#endif //AIRPORTSIMULATOR_TRACE_H
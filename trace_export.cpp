@@ -0,0 +1,38 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <iostream>
+#include <fstream>
+
+#include "trace.h"
+
+using namespace std;
+
+/*
+ * Turns a trace dump (see trace_dump()) into Chrome/Perfetto trace JSON, for chrome://tracing
+ * or ui.perfetto.dev.
+ * Usage: AirportTraceExport dump [out.json]  (stdout without out.json)
+ */
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        cerr << "usage: " << argv[0] << " dump [out.json]\n";
+        return 1;
+    }
+    TraceFile file;
+    if (!trace_load(argv[1], file)) {
+        cerr << argv[1] << " is not a trace dump\n";
+        return 1;
+    }
+    if (argc < 3) {
+        write_chrome_trace(file, cout);
+        return 0;
+    }
+    ofstream out(argv[2]);
+    if (!out) {
+        cerr << "cannot write " << argv[2] << '\n';
+        return 1;
+    }
+    write_chrome_trace(file, out);
+    return 0;
+}
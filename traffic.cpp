@@ -0,0 +1,361 @@
+//
+// Created by Yimeng Li on 18/10/2026.
+//
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include "airport.h"
+#include "timer_service.h"
+#include "trace.h"
+#include "random.h"
+
+using namespace std;
+using namespace std::chrono;
+
+/**
+ * Synthetic traffic generator. Generator threads, each drawing its own streams of the seed,
+ * pace arrivals to a target rate on the wall clock. Every aircraft waits for its landing
+ * through the FIFO wait queue, lands, turns around and queues again for take-off. Reports
+ * achieved rates and how long aircraft held for their runway.
+ *
+ * Usage: AirportTraffic [--profile poisson|bank|burst] [--rate arrivals/s] [--aircraft n]
+ *                       [--threads n] [--runways n] [--stands n] [--op-us us] [--turnaround-us us]
+ *                       [--seed n] [--trace dump]
+ *
+ * --trace writes the airport's trace rings to dump at the end; it needs a build with
+ * -DAIRPORT_TRACE=ON and is read with AirportTraceExport.
+ */
+
+enum class Profile { Poisson, Bank, Burst };
+
+struct TrafficConfig {
+    Profile profile = Profile::Poisson;
+    double rate = 5000;             // mean arrivals per second, over all threads
+    long aircraft = 100000;
+    int threads = 2;
+    int runways = 16;
+    int stands = 4096;
+    long op_us = 1000;              // runway occupancy of one landing or take-off
+    long turnaround_us = 5000;      // mean time on the stand
+    uint64_t seed = 42;
+    string trace_path;              // empty: no trace dump
+
+    double bank_period_sec = 1;     // Bank: all of a period's arrivals cluster around its middle
+    double burst_period_sec = 10;   // Burst: calm traffic, then burst_factor x for burst_sec
+    double burst_sec = 2;
+    double burst_factor = 5;
+};
+
+/** Arrival times in seconds since the start, for one generator thread. */
+class ArrivalProcess {
+private:
+    const TrafficConfig &config;
+    double rate;                    // this thread's share of config.rate
+    Xoshiro256 &rng;
+    RandomBulk bulk;                // the gaps, drawn a block at a time
+    double gaps[256];               // exponential with mean 1, scaled to the rate they are used at
+    size_t used = 256;
+    double t = 0;
+    deque<double> bank;
+    long next_bank = 0;
+
+    double gap(double r) {
+        if (used == 256) {
+            bulk.fill_exponential(gaps, 256, 1.0);
+            used = 0;
+        }
+        return gaps[used++] / r;
+    }
+
+    /*
+     * Storm recovery: the same mean rate, but burst_factor times denser during the first
+     * burst_sec of every period. Exponential gaps are memoryless, so a gap that crosses a
+     * rate change can restart at the boundary.
+     */
+    double next_burst() {
+        double period = config.burst_period_sec;
+        double calm = rate * period / (period + (config.burst_factor - 1) * config.burst_sec);
+        for (;;) {
+            double phase = fmod(t, period);
+            bool bursting = phase < config.burst_sec;
+            double boundary = t - phase + (bursting ? config.burst_sec : period);
+            double gap = this->gap(bursting ? calm * config.burst_factor : calm);
+            if (t + gap < boundary) {
+                t += gap;
+                return t;
+            }
+            t = boundary;
+        }
+    }
+
+    /*
+     * Hub banks: each period's arrivals are spread normally around the middle of the period.
+     */
+    double next_bank_arrival() {
+        while (bank.empty()) {
+            double period = config.bank_period_sec;
+            double start = next_bank++ * period;
+            uint64_t n = poisson(rng, rate * period);
+            for (uint64_t i = 0; i < n; ++i) {
+                bank.push_back(min(max(normal(rng, start + period / 2, period / 8), start), start + period));
+            }
+            sort(bank.begin(), bank.end());
+        }
+        t = bank.front();
+        bank.pop_front();
+        return t;
+    }
+
+public:
+    /*
+     * @param stream: the generator thread's; the gaps come from a stream of their own
+     */
+    ArrivalProcess(const TrafficConfig &config, double rate, Xoshiro256 &rng, uint64_t stream) :
+            config(config), rate(rate), rng(rng), bulk(config.seed, stream + config.threads) {}
+
+    double next() {
+        switch (config.profile) {
+            case Profile::Bank:
+                return next_bank_arrival();
+            case Profile::Burst:
+                return next_burst();
+            default:
+                t += gap(rate);
+                return t;
+        }
+    }
+};
+
+/** Log2 buckets of microseconds, filled from any thread. */
+class HoldHistogram {
+private:
+    static const int kBuckets = 40;
+    atomic<uint64_t> buckets[kBuckets];
+    atomic<uint64_t> max_us {0};
+
+public:
+    HoldHistogram() {
+        for (auto &b : buckets) {
+            b = 0;
+        }
+    }
+
+    void record(nanoseconds hold) {
+        uint64_t us = static_cast<uint64_t>(std::max<int64_t>(0, duration_cast<microseconds>(hold).count()));
+        int b = 0;
+        while (b + 1 < kBuckets && (us >> b) > 1) {
+            ++b;
+        }
+        ++buckets[b];
+        uint64_t seen = max_us.load();
+        while (us > seen && !max_us.compare_exchange_weak(seen, us)) {}
+    }
+
+    uint64_t count() const {
+        uint64_t n = 0;
+        for (auto &b : buckets) {
+            n += b.load();
+        }
+        return n;
+    }
+
+    /** Upper bound of the bucket holding quantile q. */
+    uint64_t percentile(double q) const {
+        uint64_t target = static_cast<uint64_t>(q * count());
+        uint64_t seen = 0;
+        for (int b = 0; b < kBuckets; ++b) {
+            seen += buckets[b].load();
+            if (seen > target) {
+                return std::min(uint64_t(2) << b, max_us.load());
+            }
+        }
+        return max_us.load();
+    }
+
+    uint64_t max() const { return max_us.load(); }
+};
+
+class Traffic {
+private:
+    const TrafficConfig &config;
+    TimerService turnarounds;       // before the airport, so it is destroyed after it
+    Airport airport;
+    HoldHistogram landing_holds;
+    HoldHistogram takeoff_holds;
+    atomic<long> issued {0};
+    atomic<long> movements {0};
+    atomic<long> departed {0};
+    atomic<long> expired {0};
+    atomic<long> early {0};
+    mutex done_lock;
+    condition_variable done_cv;
+
+    void arrive(const string &id, microseconds turnaround) {
+        steady_clock::time_point requested = steady_clock::now();
+        airport.request_landing_async(id, [this, id, turnaround, requested](LandingRequestToken token) {
+            landing_holds.record(steady_clock::now() - requested);
+            try {
+                airport.perform_landing(token);
+            }
+            catch (runtime_error &) {
+                ++expired;          // granted too late to use, queue again
+                arrive(id, turnaround);
+                return;
+            }
+            ++movements;
+            turnarounds.schedule_after(microseconds(config.op_us) + turnaround, [this, id]() { depart(id); });
+        });
+    }
+
+    void depart(const string &id) {
+        steady_clock::time_point requested = steady_clock::now();
+        try {
+            airport.request_takeoff_async(id, [this, id, requested](TakeOffRequestToken token) {
+                takeoff_holds.record(steady_clock::now() - requested);
+                try {
+                    airport.perform_takeoff(token);
+                }
+                catch (runtime_error &) {
+                    ++expired;
+                    depart(id);
+                    return;
+                }
+                ++movements;
+                if (++departed == config.aircraft) {
+                    lock_guard<mutex> guard(done_lock);
+                    done_cv.notify_all();
+                }
+            });
+        }
+        catch (runtime_error &) {
+            ++early;                // the landing has not completed yet
+            turnarounds.schedule_after(microseconds(config.op_us), [this, id]() { depart(id); });
+        }
+    }
+
+    void generate(int t, steady_clock::time_point start) {
+        Xoshiro256 rng(config.seed, t);
+        ArrivalProcess arrivals(config, config.rate / config.threads, rng, t);
+        for (long i = t; i < config.aircraft; i += config.threads) {
+            double at = arrivals.next();
+            this_thread::sleep_until(start + duration_cast<steady_clock::duration>(duration<double>(at)));
+            // Half the mean turnaround is fixed, the other half exponential.
+            long extra = static_cast<long>(exponential(rng, config.turnaround_us / 2.0));
+            microseconds turnaround(config.turnaround_us / 2 + extra);
+            arrive("Aircraft " + to_string(i), turnaround);
+            ++issued;
+        }
+    }
+
+    static void print_holds(const char *name, const HoldHistogram &holds) {
+        cout << setw(10) << name << setw(12) << holds.count() << setw(10) << holds.percentile(0.5)
+             << setw(10) << holds.percentile(0.9) << setw(10) << holds.percentile(0.99)
+             << setw(10) << holds.percentile(0.999) << setw(10) << holds.max() << '\n';
+    }
+
+public:
+    explicit Traffic(const TrafficConfig &config) : config(config), turnarounds(1) {
+        airport.set_operation_duration(microseconds(config.op_us));
+        for (int i = 0; i < config.runways; ++i) {
+            airport.add_runway(make_shared<Runway>(i));
+        }
+        for (int i = 0; i < config.stands; ++i) {
+            airport.add_parking_stands(make_shared<ParkingStand>(i));
+        }
+    }
+
+    void run() {
+        steady_clock::time_point start = steady_clock::now();
+        vector<thread> generators;
+        for (int t = 0; t < config.threads; ++t) {
+            generators.emplace_back([this, t, start]() { generate(t, start); });
+        }
+        for (auto &g : generators) {
+            g.join();
+        }
+        duration<double> issuing = steady_clock::now() - start;
+        {
+            unique_lock<mutex> guard(done_lock);
+            done_cv.wait(guard, [this]() { return departed.load() == config.aircraft; });
+        }
+        airport.wait_idle();
+        duration<double> total = steady_clock::now() - start;
+
+        cout << fixed << setprecision(0) << "target " << config.rate << " arrivals/s, " << config.threads
+             << " threads, " << config.runways << " runways, " << config.stands << " stands, op "
+             << config.op_us << "us, turnaround " << config.turnaround_us << "us\n"
+             << "issued " << issued.load() << " arrivals in " << setprecision(2) << issuing.count() << "s ("
+             << setprecision(0) << issued.load() / issuing.count() << "/s), "
+             << movements.load() << " movements in " << setprecision(2) << total.count() << "s ("
+             << setprecision(0) << movements.load() / total.count() << "/s)\n\n"
+             << setw(10) << "hold us" << setw(12) << "count" << setw(10) << "p50" << setw(10) << "p90"
+             << setw(10) << "p99" << setw(10) << "p999" << setw(10) << "max" << '\n';
+        print_holds("landing", landing_holds);
+        print_holds("takeoff", takeoff_holds);
+        cout << "\nexpired grants " << expired.load() << ", take-offs before landing completed " << early.load()
+             << '\n';
+    }
+};
+
+int main(int argc, char **argv) {
+    TrafficConfig config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char *key = argv[i];
+        const char *value = argv[i + 1];
+        if (!strcmp(key, "--profile")) {
+            config.profile = !strcmp(value, "bank") ? Profile::Bank :
+                             !strcmp(value, "burst") ? Profile::Burst : Profile::Poisson;
+        }
+        else if (!strcmp(key, "--rate")) {
+            config.rate = atof(value);
+        }
+        else if (!strcmp(key, "--aircraft")) {
+            config.aircraft = atol(value);
+        }
+        else if (!strcmp(key, "--threads")) {
+            config.threads = max(1, atoi(value));
+        }
+        else if (!strcmp(key, "--runways")) {
+            config.runways = atoi(value);
+        }
+        else if (!strcmp(key, "--stands")) {
+            config.stands = atoi(value);
+        }
+        else if (!strcmp(key, "--op-us")) {
+            config.op_us = atol(value);
+        }
+        else if (!strcmp(key, "--turnaround-us")) {
+            config.turnaround_us = atol(value);
+        }
+        else if (!strcmp(key, "--seed")) {
+            config.seed = strtoull(value, nullptr, 10);
+        }
+        else if (!strcmp(key, "--trace")) {
+            config.trace_path = value;
+        }
+        else {
+            cerr << "unknown option " << key << '\n';
+            return 1;
+        }
+    }
+    Traffic traffic(config);
+    traffic.run();
+    if (!config.trace_path.empty() && !trace_dump(config.trace_path)) {
+        cerr << "cannot write " << config.trace_path << '\n';
+        return 1;
+    }
+    return 0;
+}